@@ -6,17 +6,18 @@
 //
 
 #include "aircraft.h"
+#include "poseBatch.h"
 
-RemoteAircraft::RemoteAircraft(Interpolator *interpolator,
+RemoteAircraft::RemoteAircraft(const PoseBatch &poses, uint16_t slot,
                                const std::string clientId,
                                const std::string &_icaoType,
                                const std::string &_icaoAirline,
                                const std::string &_livery,
                                XPMPPlaneID _modeS_id, const std::string &_cslId)
-    : Aircraft(_icaoType, _icaoAirline, _livery, _modeS_id, _cslId) {
+    : Aircraft(_icaoType, _icaoAirline, _livery, _modeS_id, _cslId),
+      poses(poses), slot(slot) {
 
     this->clientId = clientId;
-    this->interpolator = interpolator;
 
     // Label
     label = clientId;
@@ -34,17 +35,65 @@ RemoteAircraft::RemoteAircraft(Interpolator *interpolator,
     strScpy(acInfoTexts.icaoAirline, _icaoAirline.c_str(),
             sizeof(acInfoTexts.icaoAirline));
     strScpy(acInfoTexts.tailNum, "D-EVEL", sizeof(acInfoTexts.tailNum));
+
+    // Configuration the peer doesn't send, set once
+    SetNoseWheelAngle(0.0f);
+    SetWingSweepRatio(0.0f);
+    SetYokePitchRatio(0.0f);
+    SetYokeHeadingRatio(0.0f);
+    SetYokeRollRatio(0.0f);
+    // tires don't roll in the air
+    SetTireDeflection(0.0f);
+    SetTireRotAngle(0.0f);
+    SetTireRotRpm(0.0f); // also sets the rad/s value!
+    // For simplicity, we keep engine and prop rotation identical...probably
+    // unrealistic
+    SetEngineRotRpm(1, PLANE_PROP_RPM); // also sets the rad/s value!
+    // 2nd engine shall turn 4 times slower...
+    SetEngineRotRpm(2, PLANE_PROP_RPM / 4); // also sets the rad/s value!
+    SetPropRotRpm(PLANE_PROP_RPM);          // also sets the rad/s value!
+    // no reversers and no moment of touch-down in flight
+    SetThrustReversRatio(0.0f);
+    SetReversDeployRatio(0.0f);
+    SetTouchDown(false);
+
+    // Defaults until the peer sends its configuration
+    setConfig();
+}
+
+void RemoteAircraft::ApplyConfig(const AircraftConfig &newConfig) {
+    if (newConfig == config) {
+        return;
+    }
+    config = newConfig;
+    setConfig();
+}
+
+void RemoteAircraft::setConfig() {
+    SetGearRatio(AircraftConfig::FromRatio(config.gear));
+    SetFlapRatio(AircraftConfig::FromRatio(config.flaps));
+    SetSlatRatio(AircraftConfig::FromRatio(config.flaps));
+    SetSpeedbrakeRatio(AircraftConfig::FromRatio(config.speedbrake));
+    SetSpoilerRatio(AircraftConfig::FromRatio(config.speedbrake));
+    SetThrustRatio(AircraftConfig::FromRatio(config.thrust));
+
+    SetLightsTaxi(config.lights & LIGHT_TAXI);
+    SetLightsLanding(config.lights & LIGHT_LANDING);
+    SetLightsBeacon(config.lights & LIGHT_BEACON);
+    SetLightsStrobe(config.lights & LIGHT_STROBE);
+    SetLightsNav(config.lights & LIGHT_NAV);
 }
 
 void RemoteAircraft::UpdatePosition(float _elapsedSinceLastCall, int) {
-    auto now = std::chrono::system_clock::now();
-    auto epoch_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        now.time_since_epoch())
-                        .count();
-    int64_t epoch_ms_int = static_cast<int64_t>(epoch_ms);
+    // Mid and far planes only get a new pose now and then, and keep the
+    // values set last time in between
+    if (!poseFresh) {
+        return;
+    }
+    poseFresh = false;
 
-    auto newState = this->interpolator->getInterpolatedState(
-        epoch_ms_int - this->interpolator->serverTimeOffset - 100);
+    // Interpolated for all planes at once, see AppState::InboundLoopCallback
+    auto newState = this->poses.Get(this->slot);
 
     newState.el /= M_per_FT; // we need elevation in feet
 
@@ -54,47 +103,20 @@ void RemoteAircraft::UpdatePosition(float _elapsedSinceLastCall, int) {
     // So, here we tell the plane its position, which takes care of vertical
     // offset, too
     SetLocation(newState.lat, newState.lon, newState.el, false);
+    if (lod == LOD_FAR) {
+        return; // attitude can't be made out at that distance
+    }
 
     // further attitude information
     SetPitch(newState.pitch);
     SetHeading(newState.heading);
     SetRoll(newState.roll);
 
-    // Plane configuration info
-    // This fills a large array of float values:
-    const float r = GetTimeUpDown(); // a value between 0 and 1
-    SetGearRatio(r);
-    SetNoseWheelAngle(r * 90.0f - 45.0f); // turn nose wheel -45°..+45°
-    SetFlapRatio(r);
-    SetSpoilerRatio(r);
-    SetSpeedbrakeRatio(r);
-    SetSlatRatio(r);
-    SetWingSweepRatio(0.0f);
-    SetThrustRatio(0.5f);
-    SetYokePitchRatio(r);
-    SetYokeHeadingRatio(r);
-    SetYokeRollRatio(r);
-
-    // lights
-    SetLightsTaxi(false);
-    SetLightsLanding(false);
-    SetLightsBeacon(true);
-    SetLightsStrobe(true);
-    SetLightsNav(true);
-
-    // tires don't roll in the air
-    SetTireDeflection(0.0f);
-    SetTireRotAngle(0.0f);
-    SetTireRotRpm(0.0f); // also sets the rad/s value!
-
-    // For simplicity, we keep engine and prop rotation identical...probably
-    // unrealistic
-    SetEngineRotRpm(1, PLANE_PROP_RPM); // also sets the rad/s value!
-    // 2nd engine shall turn 4 times slower...
-    SetEngineRotRpm(2, PLANE_PROP_RPM / 4); // also sets the rad/s value!
-
-    SetPropRotRpm(PLANE_PROP_RPM); // also sets the rad/s value!
+    if (lod != LOD_NEAR) {
+        return; // animations stay frozen
+    }
 
+    // Configuration only changes in ApplyConfig, the setters' values stay.
     // Current position of engine / prop: keeps turning as per engine/prop
     // speed:
     float deg = std::fmod(PLANE_PROP_RPM * PLANE_CIRCLE_TIME_MIN *
@@ -108,9 +130,4 @@ void RemoteAircraft::UpdatePosition(float _elapsedSinceLastCall, int) {
     SetEngineRotAngle(2, deg);
 
     SetPropRotAngle(deg);
-
-    // no reversers and no moment of touch-down in flight
-    SetThrustReversRatio(0.0f);
-    SetReversDeployRatio(0.0f);
-    SetTouchDown(false);
 }
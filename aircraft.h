@@ -11,19 +11,33 @@
 // Include XPMP2 headers
 #include "util.h"
 #include "interpolator.h"
+#include "lod.h"
+#include "protocol.h"
 
 static constexpr float UPDATE_INTERVAL = 1.0f / 25.0f; // 30 FPS
 
 using namespace XPMP2;
 
+class PoseBatch;
+
 class RemoteAircraft : public Aircraft {
   private:
     std::string clientId;
-    Interpolator* interpolator;
+    // Where our interpolated pose is computed each frame
+    const PoseBatch& poses;
+    uint16_t slot;
+    // What the configuration setters were last called with
+    AircraftConfig config;
+    // Set by OnPoseUpdated, UpdatePosition skips frames without a new pose
+    LodTier lod = LOD_NEAR;
+    bool poseFresh = false;
+
+    void setConfig();
 
   public:
     /// Constructor
-    RemoteAircraft(Interpolator* interprolator,
+    RemoteAircraft(const PoseBatch& poses,
+                   uint16_t slot,
                    const std::string clientId,
                    const std::string &_icaoType,
                    const std::string &_icaoAirline,
@@ -31,6 +45,16 @@ class RemoteAircraft : public Aircraft {
                    XPMPPlaneID _modeS_id = 0,
                    const std::string &_cslId = "");
 
+    /// Sets gear, flaps, lights etc. if `newConfig` differs from the
+    /// current configuration; they keep their values between frames
+    void ApplyConfig(const AircraftConfig &newConfig);
+
+    /// The pose of our slot was recomputed this frame, in tier `tier`
+    void OnPoseUpdated(LodTier tier) {
+        lod = tier;
+        poseFresh = true;
+    }
+
     /// Custom implementation for updating aircraft position and state
     virtual void UpdatePosition(float, int) override;
 };
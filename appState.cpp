@@ -7,6 +7,9 @@
 
 #include "appState.h"
 
+#include <limits>
+#include <new>
+
 AppState *AppState::instance = nullptr;
 XPLMDataRef AppState::planeLat = nullptr;
 XPLMDataRef AppState::planeLon = nullptr;
@@ -14,6 +17,15 @@ XPLMDataRef AppState::planeEl = nullptr;
 XPLMDataRef AppState::planePitch = nullptr;
 XPLMDataRef AppState::planeRoll = nullptr;
 XPLMDataRef AppState::planeHeading = nullptr;
+XPLMDataRef AppState::planeGear = nullptr;
+XPLMDataRef AppState::planeFlaps = nullptr;
+XPLMDataRef AppState::planeSpeedbrake = nullptr;
+XPLMDataRef AppState::planeThrottle = nullptr;
+XPLMDataRef AppState::lightsTaxi = nullptr;
+XPLMDataRef AppState::lightsLanding = nullptr;
+XPLMDataRef AppState::lightsBeacon = nullptr;
+XPLMDataRef AppState::lightsStrobe = nullptr;
+XPLMDataRef AppState::lightsNav = nullptr;
 
 AppState::AppState() {
     /* Find the data refs we want to record. */
@@ -23,6 +35,18 @@ AppState::AppState() {
     planePitch = XPLMFindDataRef("sim/flightmodel/position/true_theta");
     planeRoll = XPLMFindDataRef("sim/flightmodel/position/true_phi");
     planeHeading = XPLMFindDataRef("sim/flightmodel/position/true_psi");
+    planeGear = XPLMFindDataRef("sim/flightmodel2/gear/deploy_ratio");
+    planeFlaps =
+        XPLMFindDataRef("sim/flightmodel2/controls/flap1_deploy_ratio");
+    planeSpeedbrake =
+        XPLMFindDataRef("sim/flightmodel2/controls/speedbrake_ratio");
+    planeThrottle =
+        XPLMFindDataRef("sim/cockpit2/engine/actuators/throttle_ratio_all");
+    lightsTaxi = XPLMFindDataRef("sim/cockpit/electrical/taxi_light_on");
+    lightsLanding = XPLMFindDataRef("sim/cockpit/electrical/landing_lights_on");
+    lightsBeacon = XPLMFindDataRef("sim/cockpit/electrical/beacon_lights_on");
+    lightsStrobe = XPLMFindDataRef("sim/cockpit/electrical/strobe_lights_on");
+    lightsNav = XPLMFindDataRef("sim/cockpit/electrical/nav_lights_on");
 }
 
 AppState *AppState::GetInstance() {
@@ -36,6 +60,13 @@ void AppState::Initialize() {
 
     // Resister Pos report flight loop
     XPLMRegisterFlightLoopCallback(PosReportLoopCallback, -1.0f, NULL);
+    // Every frame, before the flight model and so before XPMP2 updates the
+    // planes: feed remote planes' data and compute their poses
+    XPLMCreateFlightLoop_t frameLoop = {
+        sizeof(XPLMCreateFlightLoop_t), xplm_FlightLoop_Phase_BeforeFlightModel,
+        InboundLoopCallback, nullptr};
+    m_frameLoop = XPLMCreateFlightLoop(&frameLoop);
+    XPLMScheduleFlightLoop(m_frameLoop, -1.0f, 1);
 
     // The path separation character, one out of /\:
     char pathSep = XPLMGetDirectorySeparator()[0];
@@ -79,12 +110,15 @@ void AppState::Initialize() {
     }
 
     LogMsg("Plugin Path: %s", szPath);
-    const std::string token = GetTokenFromFile(std::strcat(szPath, "config"));
-    if (token != "") {
+    LogMsg("Pose interpolation kernel: %s", PoseBatch::KernelName());
+    const std::string configPath = std::string(szPath) + "config";
+    Config::GetInstance()->Load(configPath);
+    Menu::GetInstance()->menuUpdateCheckmarks(); // may toggle config items
+    const Config *config = Config::GetInstance();
+    if (config->token != "") {
         // Launch the WebSocket connection on a new thread
         WebSocketClient &wsClient = WebSocketClient::getInstance();
-        const std::string uri = "ws://app.xairline.org/apis/mp?auth=";
-        wsClient.connect(uri + token);
+        wsClient.connect(config->serverUri + config->token);
     } else {
         LogMsg("Failed to get Token: check %s", szPath);
     }
@@ -98,9 +132,15 @@ void AppState::Initialize() {
 void AppState::Deinitialize() {
     // Stop pos reporting flight loop
     XPLMUnregisterFlightLoopCallback(PosReportLoopCallback, NULL);
+    if (m_frameLoop) {
+        XPLMDestroyFlightLoop(m_frameLoop);
+        m_frameLoop = nullptr;
+    }
 
-    // TODO: Remove the planes
-    //     PlanesRemove();
+    // Remove the planes while XPMP2 is still there to take them
+    for (uint16_t slot = 0; slot < m_peers.Count(); ++slot) {
+        destroyPlane(slot);
+    }
 
     // Give up AI plane control
     XPMPMultiplayerDisable();
@@ -116,63 +156,532 @@ void AppState::Deinitialize() {
 float AppState::PosReportLoopCallback(float inElapsedSinceLastCall,
                                       float inElapsedTimeSinceLastFlightLoop,
                                       int inCounter, void *inRefcon) {
-    float lat = XPLMGetDataf(planeLat);
-    float lon = XPLMGetDataf(planeLon);
-    float el = XPLMGetDataf(planeEl);
+    // Position datarefs are doubles, reading them as float costs ~1m
+    double lat = XPLMGetDatad(planeLat);
+    double lon = XPLMGetDatad(planeLon);
+    double el = XPLMGetDatad(planeEl);
     float pitch = XPLMGetDataf(planePitch);
     float roll = XPLMGetDataf(planeRoll);
     float heading = XPLMGetDataf(planeHeading);
 
-    // Create a comma-separated string from the values.
-    std::string message = std::to_string(lat) + "," + std::to_string(lon) +
-                          "," + std::to_string(el) + "," +
-                          std::to_string(pitch) + "," + std::to_string(roll) +
-                          "," + std::to_string(heading);
-    // Send the binary message.
-    try {
-        WebSocketClient::getInstance().send(message);
-    } catch (const websocketpp::lib::error_code &e) {
-        LogMsg("Send error: %s", e.message().c_str());
-    }
-
-    std::lock_guard<std::mutex> lock(AppState::GetInstance()->m_mutex);
-    while (!AppState::GetInstance()->remoteAircraftInfo.empty()) {
-        // Process the last element.
-        auto info = AppState::GetInstance()->remoteAircraftInfo.back();
-        LogMsg("New Remote player: %s, time offset(ms): %d", info.c_str(),
-               AppState::GetInstance()
-                   ->remotePlanes[info]
-                   ->interpolator->serverTimeOffset);
-        AppState::GetInstance()->remotePlanes[info]->remotePlane =
-            new RemoteAircraft(
-                AppState::GetInstance()->remotePlanes[info]->interpolator, info,
-                "A320", // type
-                "ACA",  // airline
-                "");    // livery
-                        // Remove the element.
-        AppState::GetInstance()->remoteAircraftInfo.pop_back();
-    }
+    const int64_t now_ms = ServerClock::LocalNow();
+    // Only hand the sample over, the asio thread decides on sending it and
+    // does the framing, so the sim never waits for networking
+    AppState *appState = AppState::GetInstance();
+    appState->m_ownState.Store({now_ms, lat, lon, el, heading, pitch, roll});
+    appState->m_ownConfig.Store(readOwnConfig());
 
     return POS_LOOP_INTERVAL;
 }
 
-void AppState::OnWebSocketMessage(const std::string &msg) {
-    // Get the current time from the system clock.
-    auto now = std::chrono::system_clock::now();
-
-    // Convert the time_since_epoch() to milliseconds.
-    auto epoch_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        now.time_since_epoch())
-                        .count();
-    std::vector<std::string> parsedMsg = splitString(msg, ',');
-    std::string clientId = parsedMsg[1];
-    std::string tsStr = parsedMsg[0];
-    int64_t offset = static_cast<int64_t>(epoch_ms) - std::stoll(tsStr);
-    if (remotePlanes[clientId] == nullptr) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        remoteAircraftInfo.push_back(clientId);
-        remotePlanes[clientId] = new NetworkAircraft();
-        remotePlanes[clientId]->interpolator = new Interpolator(offset);
-    }
-    remotePlanes[clientId]->interpolator->OnWebSocketMessage(msg);
+AircraftConfig AppState::readOwnConfig() {
+    AircraftConfig config;
+    float gear = 0.0f; // of the first gear, usually the nose gear
+    XPLMGetDatavf(planeGear, &gear, 0, 1);
+    config.gear = AircraftConfig::ToRatio(gear);
+    config.flaps = AircraftConfig::ToRatio(XPLMGetDataf(planeFlaps));
+    config.speedbrake = AircraftConfig::ToRatio(XPLMGetDataf(planeSpeedbrake));
+    config.thrust = AircraftConfig::ToRatio(XPLMGetDataf(planeThrottle));
+    config.lights = (XPLMGetDatai(lightsTaxi) ? LIGHT_TAXI : 0) |
+                    (XPLMGetDatai(lightsLanding) ? LIGHT_LANDING : 0) |
+                    (XPLMGetDatai(lightsBeacon) ? LIGHT_BEACON : 0) |
+                    (XPLMGetDatai(lightsStrobe) ? LIGHT_STROBE : 0) |
+                    (XPLMGetDatai(lightsNav) ? LIGHT_NAV : 0);
+    return config;
+}
+
+// Flightloop, every frame: takes over what the asio thread decoded since the
+// last frame, without locking anything
+float AppState::InboundLoopCallback(float inElapsedSinceLastCall,
+                                    float inElapsedTimeSinceLastFlightLoop,
+                                    int inCounter, void *inRefcon) {
+    AppState *appState = AppState::GetInstance();
+    const uint16_t count = appState->m_peers.Count();
+
+    // One clock read for all remote planes and the whole frame
+    UpdateRenderContext(ServerClock::GetInstance()->Now());
+    const int64_t now_ms = gRenderCtx.serverTimeMs;
+
+    // Our position, for the planes' level of detail
+    const double ownLat = XPLMGetDatad(planeLat);
+    const double ownLon = XPLMGetDatad(planeLon);
+    const double ownEl = XPLMGetDatad(planeEl);
+
+    // One index query a LOD round measures the planes within mid range,
+    // everything it doesn't find is far
+    if (now_ms - appState->m_lodRoundMs >= LOD_MID_INTERVAL_MS ||
+        now_ms < appState->m_lodRoundMs) {
+        appState->m_lodRoundMs = now_ms;
+        const uint32_t round = ++appState->m_lodRound;
+        const size_t found = std::min<size_t>(
+            appState->m_spatial.Radius(ownLat, ownLon,
+                                       LOD_MID_M * LOD_HYSTERESIS,
+                                       appState->m_lodSlots, MAX_PEERS,
+                                       appState->m_lodDistM),
+            MAX_PEERS);
+        for (size_t i = 0; i < found; ++i) {
+            const uint16_t slot = appState->m_lodSlots[i];
+            NetworkAircraft &peer = appState->m_peers[slot];
+            peer.lodRound = round;
+            peer.lodDistM = std::hypot(appState->m_lodDistM[i],
+                                       appState->m_poses.Get(slot).el - ownEl);
+        }
+    }
+
+    InboundState in;
+    for (uint16_t slot = 0; slot < count; ++slot) {
+        NetworkAircraft &peer = appState->m_peers[slot];
+        const uint8_t state = peer.state.load(std::memory_order_acquire);
+        if (state == SLOT_LEAVING) {
+            appState->releasePeer(slot);
+        }
+        if (state != SLOT_ACTIVE) {
+            continue;
+        }
+
+        if (peer.config.Load(peer.lastConfig) && peer.remotePlane) {
+            peer.remotePlane->ApplyConfig(peer.lastConfig);
+        }
+        while (peer.inbound.Pop(in)) {
+            peer.interpolator.OnPosReport(in.state, in.arrivalMs);
+            peer.lastReportMs = in.arrivalMs;
+        }
+        // Only planes with fresh data are shown, XPMP2 aircraft are costly
+        if (now_ms - peer.lastReportMs > PEER_STALE_MS) {
+            if (peer.remotePlane) {
+                appState->hidePeer(slot);
+            }
+            continue;
+        }
+        if (!peer.remotePlane) {
+            appState->showPeer(slot);
+        }
+
+        if (now_ms < peer.lodNextMs) {
+            continue; // the batch recomputes the pose gathered last time
+        }
+
+        // Tier by where the plane was shown last, good enough at tier scale.
+        // New planes start near, until the first round after they got a
+        // pose and went into the index measures them.
+        const Interpolator::EntityState shown = appState->m_poses.Get(slot);
+        double distM = 0.0;
+        if (shown.timestamp != 0) {
+            if (!appState->m_spatial.Contains(slot)) {
+                peer.lodRound = appState->m_lodRound;
+                peer.lodDistM = 0.0;
+            }
+            appState->m_spatial.Update(slot, shown.lat, shown.lon);
+            distM = peer.lodRound == appState->m_lodRound
+                        ? peer.lodDistM
+                        : std::numeric_limits<double>::infinity();
+        }
+        const LodTier lod = NextLodTier(peer.lod, distM);
+        if (lod == LOD_NEAR) {
+            peer.lodNextMs = 0;
+        } else if (lod != peer.lod) {
+            // Spread planes over the interval, so they don't all come due in
+            // the same frame
+            const int64_t interval =
+                lod == LOD_MID ? LOD_MID_INTERVAL_MS : LOD_FAR_INTERVAL_MS;
+            peer.lodNextMs = now_ms + interval * (slot % 8 + 1) / 8;
+        } else {
+            peer.lodNextMs +=
+                lod == LOD_MID ? LOD_MID_INTERVAL_MS : LOD_FAR_INTERVAL_MS;
+            peer.lodNextMs = std::max(peer.lodNextMs, now_ms);
+        }
+        peer.lod = lod;
+
+        appState->m_poses.Gather(slot, peer.interpolator,
+                                 peer.interpolator.getRenderTime(now_ms));
+        peer.remotePlane->OnPoseUpdated(lod);
+    }
+    // The planes' UpdatePosition just read their slot then
+    appState->m_poses.Run(count);
+
+    // Late data shows on every frame, so only log a summary now and then
+    if (now_ms - appState->m_lateLogTime >= LATE_LOG_INTERVAL_MS) {
+        appState->m_lateLogTime = now_ms;
+        uint32_t lateFrames = 0, latePeers = 0;
+        Interpolator::ReorderStats reorder;
+        for (uint16_t slot = 0; slot < count; ++slot) {
+            NetworkAircraft &peer = appState->m_peers[slot];
+            if (peer.state.load(std::memory_order_acquire) != SLOT_ACTIVE) {
+                continue;
+            }
+            const uint32_t n = peer.interpolator.TakeLateFrames();
+            lateFrames += n;
+            latePeers += n > 0;
+            const Interpolator::ReorderStats r =
+                peer.interpolator.TakeReorderStats();
+            reorder.reordered += r.reordered;
+            reorder.maxDepth = std::max(reorder.maxDepth, r.maxDepth);
+            reorder.duplicates += r.duplicates;
+            reorder.tooLate += r.tooLate;
+        }
+        if (lateFrames > 0) {
+            LogMsg("WARNING: network delay: %u frames of %u remote players "
+                   "beyond the extrapolation horizon in the last %ds",
+                   lateFrames, latePeers, LATE_LOG_INTERVAL_MS / 1000);
+        }
+        if (reorder.reordered + reorder.duplicates + reorder.tooLate > 0) {
+            LogMsg("Reports in the last %ds: %u reordered (depth up to %u), "
+                   "%u duplicates, %u too late",
+                   LATE_LOG_INTERVAL_MS / 1000, reorder.reordered,
+                   reorder.maxDepth, reorder.duplicates, reorder.tooLate);
+        }
+        uint16_t nearest;
+        double nearestM;
+        if (appState->m_spatial.Nearest(ownLat, ownLon, 1, &nearest,
+                                        &nearestM)) {
+            const size_t nearCount =
+                appState->m_spatial.Radius(ownLat, ownLon, LOD_NEAR_M,
+                                           nullptr, 0);
+            LogMsg("Remote players: %u, %u within %.0f km, nearest %s at "
+                   "%.1f km",
+                   count, unsigned(nearCount), LOD_NEAR_M / 1000.0,
+                   appState->m_peers[nearest].clientId.c_str(),
+                   nearestM / 1000.0);
+        }
+    }
+
+    return -1.0f; // call again next frame
+}
+
+void AppState::showPeer(uint16_t slot) {
+    NetworkAircraft &peer = m_peers[slot];
+    LogMsg("New Remote player: %s", peer.clientId.c_str());
+    peer.remotePlane = new (m_planeSlab[slot])
+        RemoteAircraft(m_poses, slot, peer.clientId,
+                       "A320", // type
+                       "ACA",  // airline
+                       "");    // livery
+    peer.remotePlane->ApplyConfig(peer.lastConfig);
+}
+
+// Destroys the XPMP2 aircraft of a slot, if there is one
+void AppState::destroyPlane(uint16_t slot) {
+    NetworkAircraft &peer = m_peers[slot];
+    if (peer.remotePlane) {
+        peer.remotePlane->~RemoteAircraft();
+        peer.remotePlane = nullptr;
+    }
+}
+
+void AppState::hidePeer(uint16_t slot) {
+    NetworkAircraft &peer = m_peers[slot];
+    LogMsg("Remote player gone quiet: %s", peer.clientId.c_str());
+    destroyPlane(slot);
+    // Start over when it shows up again
+    m_spatial.Remove(slot);
+    m_poses.Reset(slot);
+    peer.lod = LOD_NEAR;
+    peer.lodNextMs = 0;
+}
+
+void AppState::releasePeer(uint16_t slot) {
+    NetworkAircraft &peer = m_peers[slot];
+    LogMsg("Remote player left: %s", peer.clientId.c_str());
+    if (peer.remotePlane) {
+        hidePeer(slot);
+    }
+    m_peers.Release(slot);
+}
+
+// Called on the asio thread every POS_LOOP_INTERVAL while connected
+void AppState::OnSendTick() {
+    // Clock sync requests need a binary subprotocol
+    WebSocketClient &wsClient = WebSocketClient::getInstance();
+    if (wsClient.getFormat() != FORMAT_CSV && --m_timeSyncTicks <= 0) {
+        m_timeSyncTicks = ServerClock::GetInstance()->IsConverging()
+                              ? TIME_SYNC_FAST_TICKS
+                              : TIME_SYNC_TICKS;
+        wsClient.sendBinary(
+            m_sendBuf, EncodeTimeRequest(ServerClock::LocalNow(), m_sendBuf,
+                                         sizeof(m_sendBuf)));
+    }
+    if (--m_idleCheckTicks <= 0) {
+        m_idleCheckTicks = IDLE_CHECK_TICKS;
+        removeIdlePeers();
+    }
+
+    Interpolator::EntityState state;
+    if (!m_ownState.Load(state)) {
+        return; // no new sample, e.g. sim paused or loading
+    }
+    updateSubscription(state);
+    // Only send if receivers' extrapolation of our last reports is off
+    if (m_sendGate.ShouldSend(state)) {
+        sendPosReport(state);
+    }
+    sendConfig();
+}
+
+// Sends our configuration if it changed, and now and then anyway
+void AppState::sendConfig() {
+    WebSocketClient &wsClient = WebSocketClient::getInstance();
+    AircraftConfig config;
+    if (wsClient.getFormat() == FORMAT_CSV || !m_ownConfig.Load(config)) {
+        return; // text frames carry no config, peers show the defaults
+    }
+    if (config == m_sentConfig && --m_configRefreshTicks > 0) {
+        return;
+    }
+    const size_t len = EncodeConfig(config, m_sendBuf, sizeof(m_sendBuf));
+    if (len == 0) {
+        return;
+    }
+    m_sentConfig = config;
+    m_configRefreshTicks = CONFIG_REFRESH_TICKS;
+    wsClient.sendBinary(m_sendBuf, len);
+}
+
+// Tells the server which remote planes we want, whenever we moved far
+// enough that the region around us is a different one
+void AppState::updateSubscription(const Interpolator::EntityState &state) {
+    m_ownPos = state;
+    m_haveOwnPos = true;
+
+    WebSocketClient &wsClient = WebSocketClient::getInstance();
+    const double radiusM = Config::GetInstance()->interestRadiusKm * 1000.0;
+    if (radiusM <= 0.0 || wsClient.getFormat() == FORMAT_CSV) {
+        return; // we get everything
+    }
+    if (m_subscribed &&
+        GroundDistanceM(m_subscription.lat, m_subscription.lon, state.lat,
+                        state.lon) < radiusM * SUBSCRIBE_MOVE_FRACTION) {
+        return;
+    }
+    m_subscribed = true;
+    m_subscription.lat = state.lat;
+    m_subscription.lon = state.lon;
+    m_subscription.radiusM = float(radiusM);
+    // No use sending more than our level of detail shows
+    m_subscription.nearM = float(LOD_NEAR_M);
+    m_subscription.midM = float(LOD_MID_M);
+    m_subscription.intervalMs[LOD_NEAR] = 0;
+    m_subscription.intervalMs[LOD_MID] = LOD_MID_INTERVAL_MS;
+    m_subscription.intervalMs[LOD_FAR] = LOD_FAR_INTERVAL_MS;
+    wsClient.sendBinary(m_sendBuf, EncodeSubscription(m_subscription,
+                                                      m_sendBuf,
+                                                      sizeof(m_sendBuf)));
+}
+
+// Whether a remote plane is in the region we subscribed to. Checked on our
+// side, too, as the server may not know subscriptions or lag behind them.
+bool AppState::inInterestRegion(const Interpolator::EntityState &state) const {
+    const double radiusM = Config::GetInstance()->interestRadiusKm * 1000.0;
+    if (radiusM <= 0.0 || !m_haveOwnPos) {
+        return true;
+    }
+    return GroundDistanceM(m_ownPos.lat, m_ownPos.lon, state.lat, state.lon) <=
+           radiusM * INTEREST_DROP_MARGIN;
+}
+
+// Sends our own state in the format negotiated with the server
+void AppState::sendPosReport(const Interpolator::EntityState &state) {
+    WebSocketClient &wsClient = WebSocketClient::getInstance();
+    uint8_t *frame = m_sendBuf;
+    char *text = reinterpret_cast<char *>(m_sendBuf);
+    const FrameFormat format = wsClient.getFormat();
+    size_t len = 0;
+    switch (format) {
+    case FORMAT_DELTA:
+        len = m_deltaEncoder.Encode(state, frame, sizeof(m_sendBuf));
+        break;
+    case FORMAT_BINARY:
+        // Fixed-layout binary frame, if the server negotiated it
+        len = EncodeBinaryPosReport(state, frame, sizeof(m_sendBuf));
+        break;
+    case FORMAT_CSV:
+        // Comma-separated text, formatted right into the send buffer
+        len = EncodeCsvPosReport(state, text, sizeof(m_sendBuf));
+        break;
+    }
+    if (len == 0) {
+        return; // didn't fit, e.g. absurd values in a text report
+    }
+    if (format == FORMAT_CSV) {
+        wsClient.send(std::string_view(text, len));
+    } else {
+        wsClient.sendBinary(frame, len);
+    }
+}
+
+void AppState::OnWebSocketMessage(std::string_view msg, bool isBinary) {
+    m_arrivalMs = ServerClock::LocalNow();
+
+    if (!isBinary) {
+        // One or more newline-separated records
+        size_t pos;
+        while ((pos = msg.find('\n')) != std::string_view::npos) {
+            if (pos > 0) {
+                handleCsvRecord(msg.substr(0, pos));
+            }
+            msg.remove_prefix(pos + 1);
+        }
+        if (!msg.empty()) {
+            handleCsvRecord(msg);
+        }
+        return;
+    }
+
+    BinaryFrame frame;
+    if (!DecodeBinaryFrame(msg, frame)) {
+        LogMsg("Error: malformed binary ws message, %d bytes", int(msg.size()));
+        return;
+    }
+    if (frame.type == FRAME_TIME) {
+        // Echo of one of our clock sync requests
+        int64_t t0, t1;
+        if (DecodeTimeReplyBody(frame.body, t0, t1)) {
+            ServerClock::GetInstance()->OnTimeReply(t0, t1, frame.timestamp,
+                                                    m_arrivalMs);
+        }
+        return;
+    }
+    if (frame.type != FRAME_SNAPSHOT) {
+        handleBinaryRecord(frame);
+        return;
+    }
+    // All clients' reports of one server tick
+    SnapshotReader snapshot(frame);
+    BinaryFrame record;
+    while (snapshot.Next(record)) {
+        handleBinaryRecord(record);
+    }
+}
+
+void AppState::handleCsvRecord(std::string_view record) {
+    // Decode the record in place, exactly once
+    PosReport report;
+    if (!DecodeCsvPosReport(record, report)) {
+        LogMsg("Error: malformed ws message: %.*s", int(record.size()),
+               record.data());
+        return;
+    }
+    if (!inInterestRegion(report.state)) {
+        return;
+    }
+    NetworkAircraft *peer = findOrAddPeer(report.clientId);
+    if (peer) {
+        peer->inbound.Push(
+            {report.state, arrivalServerTime(report.state.timestamp)});
+        peer->lastArrivalMs = m_arrivalMs;
+    }
+}
+
+void AppState::handleBinaryRecord(const BinaryFrame &frame) {
+    NetworkAircraft *peer = m_peers.Find(frame.clientId);
+    if (frame.type == FRAME_LEAVE) {
+        if (peer) {
+            removePeer(*peer);
+        }
+        return;
+    }
+    if (frame.type == FRAME_CONFIG) {
+        // Only positions in our region add clients, a client's config is
+        // sent again now and then
+        AircraftConfig config;
+        if (peer && DecodeConfigBody(frame.body, config)) {
+            peer->config.Store(config);
+        }
+        return;
+    }
+    if (!peer && frame.type == FRAME_DELTA) {
+        // Useless before its next keyframe, which it sends as soon as it
+        // sees us join, and at least every KEYFRAME_INTERVAL_MS
+        return;
+    }
+
+    // A new client only gets a slot, and its decoder, if it's in our region
+    DeltaDecoder newDecoder;
+    DeltaDecoder &decoder = peer ? peer->deltaDecoder : newDecoder;
+    Interpolator::EntityState state;
+    state.timestamp = frame.timestamp;
+    const bool ok = frame.type == FRAME_POS
+                        ? DecodeBinaryPosBody(frame.body, state)
+                        : decoder.Decode(frame.type, frame.body, state);
+    if (!ok) {
+        return; // malformed, or a delta waiting for the next keyframe
+    }
+    // Known clients' decoders stay in sync while they are outside
+    if (!inInterestRegion(state)) {
+        return;
+    }
+    if (!peer) {
+        peer = findOrAddPeer(frame.clientId);
+        if (!peer) {
+            return;
+        }
+        peer->deltaDecoder = newDecoder;
+    }
+    // If the sim doesn't drain for seconds (loading) states get dropped
+    peer->inbound.Push({state, arrivalServerTime(frame.timestamp)});
+    peer->lastArrivalMs = m_arrivalMs;
+}
+
+// Called on the asio thread on every new connection
+void AppState::OnWebSocketOpen() {
+    m_timeSyncTicks = 0; // sync the clock right away
+    // Our own stream restarts with a full report...
+    m_sendGate.Reset();
+    m_deltaEncoder.Reset();
+    m_configRefreshTicks = 0;
+    m_subscribed = false; // a new connection receives everything
+    // ...and those of all clients with the keyframe they send on seeing us
+    // join again
+    for (uint16_t slot = 0; slot < m_peers.Count(); ++slot) {
+        m_peers[slot].deltaDecoder.Reset();
+    }
+}
+
+int64_t AppState::arrivalServerTime(int64_t timestamp) {
+    ServerClock *clock = ServerClock::GetInstance();
+    // Best guess until a clock sync exchange succeeds
+    clock->Seed(timestamp, m_arrivalMs);
+    return clock->ToServer(m_arrivalMs);
+}
+
+NetworkAircraft *AppState::findOrAddPeer(std::string_view clientId) {
+    NetworkAircraft *peer = m_peers.Find(clientId);
+    if (peer) {
+        return peer;
+    }
+
+    peer = m_peers.Add(clientId);
+    if (!peer) {
+        if (!m_peersFullLogged) {
+            LogMsg("Too many remote players (%d), ignoring new ones",
+                   (int)MAX_PEERS);
+            m_peersFullLogged = true;
+        }
+        return nullptr;
+    }
+    // Fully set up before the sim thread gets to see it
+    m_peers.Publish(*peer);
+    // It just joined or came into range, and likely never got a keyframe
+    // of ours to decode our deltas with
+    m_deltaEncoder.Reset();
+    return peer;
+}
+
+void AppState::removePeer(NetworkAircraft &peer) {
+    m_peers.Remove(peer);
+    m_peersFullLogged = false; // a slot will be free again
+}
+
+// Forgets peers that stopped reporting without the server telling us, e.g.
+// because they left our interest region
+void AppState::removeIdlePeers() {
+    const int64_t idleMs =
+        int64_t(Config::GetInstance()->peerIdleTimeoutS * 1000.0);
+    const int64_t now = ServerClock::LocalNow();
+    for (uint16_t slot = 0; slot < m_peers.Count(); ++slot) {
+        NetworkAircraft &peer = m_peers[slot];
+        if (peer.state.load(std::memory_order_relaxed) == SLOT_ACTIVE &&
+            now - peer.lastArrivalMs > idleMs) {
+            removePeer(peer);
+        }
+    }
 }
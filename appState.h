@@ -8,6 +8,17 @@
 #define APP_STATE_H
 
 #define POS_LOOP_INTERVAL 0.05f // 1/20
+#define LATE_LOG_INTERVAL_MS 10000 // summarize late data this often
+#define TIME_SYNC_TICKS 40         // sync the clock every 2s...
+#define TIME_SYNC_FAST_TICKS 4     // ...and every 0.2s while converging
+#define CONFIG_REFRESH_TICKS 100   // resend an unchanged config every 5s
+#define SUBSCRIBE_MOVE_FRACTION 0.1 // resubscribe after moving this part of
+                                    // the interest radius
+#define INTEREST_DROP_MARGIN 1.2    // drop remote planes beyond this part of
+                                    // the interest radius
+#define PEER_STALE_MS int64_t(4000 * MAX_HEARTBEAT_S) // hide remote planes
+                                    // that missed 4 heartbeats...
+#define IDLE_CHECK_TICKS 20        // ...and look for idle ones every 1s
 // X-Plane SDK
 #include "XPLMDataAccess.h"
 #include "XPLMGraphics.h"
@@ -17,26 +28,33 @@
 #include "XPLMUtilities.h"
 
 #include "aircraft.h"
+#include "config.h"
+#include "deadReckoning.h"
 #include "interpolator.h"
+#include "lockfree.h"
 #include "menu.h"
+#include "peerRegistry.h"
+#include "poseBatch.h"
+#include "protocol.h"
+#include "serverClock.h"
+#include "spatialIndex.h"
 #include "util.h"
 #include "websocket.h"
 
-struct NetworkAircraft {
-    RemoteAircraft *remotePlane;
-    Interpolator *interpolator;
-};
-
 class AppState final {
   public:
     static AppState *GetInstance();
-    std::map<std::string, NetworkAircraft *> remotePlanes;
     void Initialize();
     void Deinitialize();
     static float PosReportLoopCallback(float inElapsedSinceLastCall,
                                        float inElapsedTimeSinceLastFlightLoop,
                                        int inCounter, void *inRefcon);
-    void OnWebSocketMessage(const std::string &msg);
+    static float InboundLoopCallback(float inElapsedSinceLastCall,
+                                     float inElapsedTimeSinceLastFlightLoop,
+                                     int inCounter, void *inRefcon);
+    void OnWebSocketMessage(std::string_view msg, bool isBinary);
+    void OnWebSocketOpen();
+    void OnSendTick();
 
   private:
     AppState();
@@ -49,8 +67,78 @@ class AppState final {
     static XPLMDataRef planePitch;
     static XPLMDataRef planeHeading;
     static XPLMDataRef planeRoll;
+    static XPLMDataRef planeGear;
+    static XPLMDataRef planeFlaps;
+    static XPLMDataRef planeSpeedbrake;
+    static XPLMDataRef planeThrottle;
+    static XPLMDataRef lightsTaxi;
+    static XPLMDataRef lightsLanding;
+    static XPLMDataRef lightsBeacon;
+    static XPLMDataRef lightsStrobe;
+    static XPLMDataRef lightsNav;
+
+    XPLMFlightLoopID m_frameLoop = nullptr;
+
+    void sendPosReport(const Interpolator::EntityState &state);
+    void sendConfig();
+    void updateSubscription(const Interpolator::EntityState &state);
+    bool inInterestRegion(const Interpolator::EntityState &state) const;
+    static AircraftConfig readOwnConfig();
+    void handleBinaryRecord(const BinaryFrame &frame);
+    void handleCsvRecord(std::string_view record);
+    NetworkAircraft *findOrAddPeer(std::string_view clientId);
+    void removePeer(NetworkAircraft &peer);
+    void removeIdlePeers();
+    // Sim thread: creates and destroys a remote plane's XPMP2 aircraft
+    void showPeer(uint16_t slot);
+    void hidePeer(uint16_t slot);
+    void destroyPlane(uint16_t slot);
+    // Sim thread: tears down a slot the asio thread removed
+    void releasePeer(uint16_t slot);
+    // Server time the message being handled arrived at
+    int64_t arrivalServerTime(int64_t timestamp);
+
+    // Latest own state, from the flight loop to the asio thread
+    LatestValue<Interpolator::EntityState> m_ownState;
+    LatestValue<AircraftConfig> m_ownConfig;
+    // Own position stream, only used on the asio thread
+    DeadReckoningGate m_sendGate;
+    DeltaEncoder m_deltaEncoder;
+    // Own configuration stream, only used on the asio thread
+    AircraftConfig m_sentConfig;
+    // Send ticks until an unchanged config is sent again, for peers that
+    // joined after the last change
+    int m_configRefreshTicks = 0;
+    // Our latest position and the one we subscribed around, asio thread
+    Interpolator::EntityState m_ownPos;
+    bool m_haveOwnPos = false;
+    Subscription m_subscription;
+    bool m_subscribed = false;
+    uint8_t m_sendBuf[MAX_UP_FRAME_SIZE];
 
-    std::mutex m_mutex;
-    std::vector<std::string> remoteAircraftInfo;
+    // All remote clients, added on the asio thread
+    PeerRegistry m_peers;
+    // Storage for each slot's XPMP2 aircraft, sim thread only. Planes come
+    // and go with their clients, nothing allocates them separately.
+    alignas(RemoteAircraft) unsigned char m_planeSlab[MAX_PEERS]
+                                                    [sizeof(RemoteAircraft)];
+    // ServerClock::LocalNow() when the message being handled arrived, asio
+    // thread
+    int64_t m_arrivalMs = 0;
+    // Send ticks until the next clock sync request, asio thread
+    int m_timeSyncTicks = 0;
+    // Send ticks until the next look for idle peers, asio thread
+    int m_idleCheckTicks = IDLE_CHECK_TICKS;
+    bool m_peersFullLogged = false;
+    // Interpolated poses of all remote planes, sim thread only
+    PoseBatch m_poses;
+    // Where the remote planes were shown, sim thread only
+    SpatialIndex m_spatial;
+    // LOD rounds: which planes the index finds within mid range, sim thread
+    uint32_t m_lodRound = 0;
+    int64_t m_lodRoundMs = 0;
+    uint16_t m_lodSlots[MAX_PEERS];
+    double m_lodDistM[MAX_PEERS];
+    int64_t m_lateLogTime = 0;
 };
 #endif // APP_STATE_H
@@ -0,0 +1,17 @@
+//
+//  common.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+
+#include "common.h"
+
+#include <cmath>
+
+double GroundDistanceM(double lat1, double lon1, double lat2, double lon2) {
+    const double north = (lat2 - lat1) * M_PER_DEG_LAT;
+    const double east = std::remainder(lon2 - lon1, 360.0) * M_PER_DEG_LAT *
+                        std::cos(deg2rad((lat1 + lat2) / 2.0));
+    return std::hypot(north, east);
+}
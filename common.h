@@ -0,0 +1,27 @@
+//
+//  common.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef COMMON_H
+#define COMMON_H
+
+/// What the X-Plane independent parts share, so that they build without the
+/// SDK and XPMP2, see `tests/`
+
+/// PI
+constexpr double PI = 3.1415926535897932384626433832795028841971693993751;
+/// Meters per degree of latitude
+constexpr double M_PER_DEG_LAT = 111320.0;
+
+/// Convert from degree to radians
+inline double deg2rad(const double deg) { return (deg * PI / 180.0); }
+/// Ground distance between two positions [m], flat-earth approximation
+/// that is good to well below 1% over a few hundred km
+double GroundDistanceM(double lat1, double lon1, double lat2, double lon2);
+
+/// Log a message with sprintf-style parameters, defined in util.cpp
+void LogMsg(const char *szMsg, ...);
+
+#endif // COMMON_H
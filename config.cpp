@@ -0,0 +1,77 @@
+//
+//  config.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+Config *Config::instance = nullptr;
+
+Config *Config::GetInstance() {
+    if (instance == nullptr) {
+        instance = new Config();
+    }
+    return instance;
+}
+
+void Config::Load(const std::string &filePath) {
+    std::ifstream infile(filePath);
+    if (!infile.is_open()) {
+        return; // keep defaults
+    }
+
+    std::string line;
+    while (std::getline(infile, line)) {
+        const size_t pos = line.find('=');
+        if (pos == std::string::npos) {
+            continue;
+        }
+        const std::string key = line.substr(0, pos);
+        const char *val = line.c_str() + pos + 1;
+        if (key == "server_uri") {
+            serverUri = val;
+        } else if (key == "send_pos_threshold_m") {
+            sendPosThresholdM = std::atof(val);
+        } else if (key == "send_att_threshold_deg") {
+            sendAttThresholdDeg = std::atof(val);
+        } else if (key == "send_heartbeat_s") {
+            sendHeartbeatS = std::clamp(std::atof(val), 0.05, MAX_HEARTBEAT_S);
+        } else if (key == "extrapolation_horizon_ms") {
+            extrapolationHorizonMs = std::atoll(val);
+        } else if (key == "convergence_ms") {
+            convergenceMs = std::max<int64_t>(0, std::atoll(val));
+        } else if (key == "jitter_percentile") {
+            jitterPercentile = std::clamp(std::atof(val), 0.0, 100.0);
+        } else if (key == "jitter_min_ms") {
+            jitterMinMs = std::max<int64_t>(0, std::atoll(val));
+        } else if (key == "jitter_max_ms") {
+            jitterMaxMs = std::max<int64_t>(0, std::atoll(val));
+        } else if (key == "interest_radius_km") {
+            interestRadiusKm = std::max(0.0, std::atof(val));
+        } else if (key == "peer_idle_timeout_s") {
+            peerIdleTimeoutS = std::max(1.0, std::atof(val));
+        } else if (key == "interpolation_hermite") {
+            interpolationHermite = std::atoi(val) != 0;
+        } else if (key == "ws_deflate") {
+            wsDeflate = std::atoi(val) != 0;
+        } else if (key == "ws_deflate_window_bits") {
+            wsDeflateWindowBits = std::clamp(std::atoi(val), 9, 15);
+        } else if (key == "ws_deflate_no_context_takeover") {
+            wsDeflateNoContextTakeover = std::atoi(val) != 0;
+        } else {
+            // The auth token, whatever its key, kept out of the log
+            if (token.empty()) {
+                token = val;
+            }
+            continue;
+        }
+        LogMsg("Config: %s", line.c_str());
+    }
+    jitterMaxMs = std::max(jitterMaxMs, jitterMinMs);
+}
@@ -0,0 +1,77 @@
+//
+//  config.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+
+#include "common.h"
+
+/// Longest heartbeat `send_heartbeat_s` may ask for [s]. Receivers hide
+/// planes that miss several of them, see `PEER_STALE_MS`.
+constexpr double MAX_HEARTBEAT_S = 1.25;
+
+/// Tunables, read from `key=value` lines of the plugin's `config` file.
+/// The first line with a key not listed here holds the auth token, other
+/// unknown keys are ignored, missing keys keep their defaults.
+class Config final {
+  public:
+    static Config *GetInstance();
+    void Load(const std::string &filePath);
+
+    /// Server to connect to, followed by the token from the config file
+    std::string serverUri = "ws://app.xairline.org/apis/mp?auth=";
+    /// Auth token, empty if the file has none. Traditionally the first line,
+    /// but tunables may come before it.
+    std::string token;
+    /// Send own position when receivers' extrapolation is off by more than
+    /// this [m]
+    double sendPosThresholdM = 1.0;
+    /// Send own position when receivers' extrapolated attitude is off by more
+    /// than this [deg]
+    double sendAttThresholdDeg = 2.0;
+    /// Send own position at least this often, even if nothing changes,
+    /// 0.05..`MAX_HEARTBEAT_S` [s]
+    double sendHeartbeatS = 1.0;
+    /// Extrapolate remote aircraft at most this far past their last report
+    /// [ms]
+    int64_t extrapolationHorizonMs = 2000;
+    /// When late data moves a remote aircraft, glide to the new pose with
+    /// this time constant instead of jumping, 0 to jump [ms]
+    int64_t convergenceMs = 300;
+    /// Render each remote aircraft late enough that this percentage of its
+    /// reports arrives in time
+    double jitterPercentile = 95.0;
+    /// Bounds of the playout delay added on top of a remote aircraft's
+    /// fastest transit time [ms]
+    int64_t jitterMinMs = 50;
+    int64_t jitterMaxMs = 500;
+    /// Ask the server for remote aircraft within this distance of us only,
+    /// 0 to receive all [km]
+    double interestRadiusKm = 150.0;
+    /// Forget remote aircraft that haven't reported for this long, unless
+    /// the server told us they left before [s]
+    double peerIdleTimeoutS = 30.0;
+    /// Interpolate remote aircraft along cubic Hermite curves instead of
+    /// straight lines, smooth enough for senders reporting at 5..8 Hz.
+    /// Can be toggled in the menu, too.
+    bool interpolationHermite = false;
+    /// Offer permessage-deflate to the server, needs a build with
+    /// INCLUDE_WS_DEFLATE
+    bool wsDeflate = false;
+    /// Our compressor's LZ77 window, 9..15 [log2 bytes]
+    int wsDeflateWindowBits = 15;
+    /// Reset our compressor for every message: less memory on both ends,
+    /// but small messages hardly compress any more
+    bool wsDeflateNoContextTakeover = false;
+
+  private:
+    Config() = default;
+    static Config *instance;
+};
+
+#endif // CONFIG_H
@@ -0,0 +1,48 @@
+//
+//  deadReckoning.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+
+#include "deadReckoning.h"
+#include "config.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool DeadReckoningGate::ShouldSend(const Interpolator::EntityState &state) {
+    const Config *config = Config::GetInstance();
+    bool send = m_numSent < 2 || state.timestamp - m_last.timestamp >=
+                                     int64_t(config->sendHeartbeatS * 1000.0);
+    if (!send) {
+        // Where do the receivers think we are?
+        const Interpolator::EntityState pred = Interpolator::Extrapolate(
+            m_prev, m_last, state.timestamp, config->extrapolationHorizonMs);
+
+        const double dNorth = (state.lat - pred.lat) * M_PER_DEG_LAT;
+        const double dEast = std::remainder(state.lon - pred.lon, 360.0) *
+                             M_PER_DEG_LAT * std::cos(deg2rad(state.lat));
+        const double dUp = state.el - pred.el;
+        const double posErr =
+            std::sqrt(dNorth * dNorth + dEast * dEast + dUp * dUp);
+
+        const double attErr =
+            std::max({std::abs(state.pitch - pred.pitch),
+                      std::abs(std::remainder(state.roll - pred.roll, 360.0)),
+                      std::abs(std::remainder(state.heading - pred.heading,
+                                              360.0))});
+
+        send = posErr > config->sendPosThresholdM ||
+               attErr > config->sendAttThresholdDeg;
+    }
+
+    if (send) {
+        m_prev = m_numSent > 0 ? m_last : state;
+        m_last = state;
+        if (m_numSent < 2) {
+            ++m_numSent;
+        }
+    }
+    return send;
+}
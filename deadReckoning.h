@@ -0,0 +1,30 @@
+//
+//  deadReckoning.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef DEAD_RECKONING_H
+#define DEAD_RECKONING_H
+
+#include "interpolator.h"
+
+/// Decides when our own position needs to be sent. Runs the receivers'
+/// extrapolation on what we sent so far and only lets a state pass if that
+/// prediction is off by more than the configured thresholds, or if the
+/// heartbeat is due.
+class DeadReckoningGate {
+  public:
+    /// @param state Own state, `timestamp` in local ms
+    /// @return `true` if `state` should be sent, it is then taken as sent
+    bool ShouldSend(const Interpolator::EntityState &state);
+    /// Next state will be sent, e.g. after a reconnect
+    void Reset() { m_numSent = 0; }
+
+  private:
+    Interpolator::EntityState m_prev{};
+    Interpolator::EntityState m_last{};
+    int m_numSent = 0;
+};
+
+#endif // DEAD_RECKONING_H
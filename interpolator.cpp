@@ -6,63 +6,220 @@
 //
 
 #include "interpolator.h"
+#include "config.h"
 
-Interpolator::Interpolator(int64_t offset) { this->serverTimeOffset = offset; }
+#include <cmath>
 
 //------------------------------------------------------------------------------
-// onWebSocketMessage
+// OnPosReport
 //------------------------------------------------------------------------------
-void Interpolator::OnWebSocketMessage(const std::string &msg) {
-    // We lock our mutex so we can safely modify/read the buffer
-    std::lock_guard<std::mutex> lock(m_mutex);
+void Interpolator::OnPosReport(const EntityState &state, int64_t arrivalMs) {
+    // Add to our buffer, dropping if out of order
+    addState(state);
 
-    try {
-        std::vector<std::string> parsedMsg = splitString(msg, ',');
-        EntityState newState;
-        newState.timestamp = std::stod(parsedMsg[0]);
-        newState.lat = std::stod(parsedMsg[2]);
-        newState.lon = std::stod(parsedMsg[3]);
-        newState.el = std::stod(parsedMsg[4]);
-        newState.pitch = std::stod(parsedMsg[5]);
-        newState.roll = std::stod(parsedMsg[6]);
-        newState.heading = std::stod(parsedMsg[7]);
+    m_transit[m_transitCount++ % TRANSIT_WINDOW] = arrivalMs - state.timestamp;
+    updateLagTarget();
+}
+
+//------------------------------------------------------------------------------
+// updateLagTarget
+//------------------------------------------------------------------------------
+void Interpolator::updateLagTarget() {
+    const Config *config = Config::GetInstance();
+    const uint32_t n = std::min(m_transitCount, TRANSIT_WINDOW);
+    int64_t sorted[TRANSIT_WINDOW] = {}; // n > 0, but -O3 can't tell
+    std::copy(m_transit, m_transit + n, sorted);
+
+    // The fastest report had no jitter, the percentile is what we wait for
+    const int64_t fastest = *std::min_element(sorted, sorted + n);
+    const uint32_t k = uint32_t(config->jitterPercentile / 100.0 * (n - 1));
+    std::nth_element(sorted, sorted + k, sorted + n);
+    const int64_t jitter = std::clamp(sorted[k] - fastest, config->jitterMinMs,
+                                      config->jitterMaxMs);
+    m_lagTarget = double(fastest + jitter);
+}
+
+//------------------------------------------------------------------------------
+// getRenderTime
+//------------------------------------------------------------------------------
+int64_t Interpolator::getRenderTime(int64_t nowMs) {
+    // Changes of the lag speed up or slow down the playout by at most this
+    // fraction, instead of jumping
+    const double MAX_LAG_SLEW = 0.1;
 
-        // Add to our buffer, dropping if out of order
-        addState(newState);
-    } catch (const std::exception &e) {
-        LogMsg("Error: on ws message: %s", e.what());
+    if (!m_hasLag) {
+        m_lag = m_lagTarget;
+        m_hasLag = m_transitCount > 0;
+    } else {
+        const double step = MAX_LAG_SLEW * double(nowMs - m_lagTime);
+        m_lag += std::clamp(m_lagTarget - m_lag, -step, step);
     }
+    m_lagTime = nowMs;
+    return nowMs - int64_t(m_lag);
 }
 
 //------------------------------------------------------------------------------
 // addState
 //------------------------------------------------------------------------------
 void Interpolator::addState(const EntityState &state) {
-    // If buffer is empty or the new timestamp is strictly newer, we push back
-    if (m_buffer.empty() || state.timestamp > m_buffer.back().timestamp) {
-        m_buffer.push_back(state);
-    } else {
-        // We "assume no out-of-order" data. So if it's older or equal, drop it.
-        // (Alternatively, if you wanted to gracefully handle partial
-        // out-of-order, you could insert with lower_bound or skip only if it's
-        // truly older.)
+    // Find the insertion point, usually the back. Reordered states go in
+    // sorted if they are among the last REORDER_WINDOW ones.
+    uint32_t pos = m_end;
+    while (pos != m_first && state.timestamp <= at(pos - 1).timestamp) {
+        if (state.timestamp == at(pos - 1).timestamp) {
+            ++m_reorderStats.duplicates;
+            return;
+        }
+        if (m_end - pos == REORDER_WINDOW) {
+            ++m_reorderStats.tooLate;
+            return;
+        }
+        --pos;
+    }
+    if (pos == m_first && size() > 0 && pos != m_end) {
+        // Older than anything we keep
+        ++m_reorderStats.tooLate;
         return;
     }
 
-    // Optional: Trim old states to keep buffer from growing too large
-    // e.g. keep only the last 1 second of data
-    const double MAX_HISTORY_SEC = 1.0; // keep 1s of data
-    double newestTime = m_buffer.back().timestamp;
+    // Keep the local frame close enough for float precision
+    const double REBASE_DISTANCE_M = 2000.0;
+    if (size() == 0) {
+        m_anchor.Set(state.lat, state.lon, state.el);
+    } else {
+        const LocalState local = m_anchor.ToLocal(state);
+        if (std::abs(local.east) > REBASE_DISTANCE_M ||
+            std::abs(local.north) > REBASE_DISTANCE_M) {
+            rebase(state);
+        }
+    }
 
-    while (!m_buffer.empty() &&
-           (newestTime - m_buffer.front().timestamp) > MAX_HISTORY_SEC * 1000) {
-        m_buffer.pop_front();
+    if (size() == HISTORY_CAPACITY) {
+        ++m_first; // overwrite the oldest
     }
-    std::string output = "";
-    for (Interpolator::EntityState &it : m_buffer) {
-        output.append(std::to_string(it.timestamp)).append(", ");
+    const uint32_t depth = m_end - pos;
+    if (depth > 0) {
+        ++m_reorderStats.reordered;
+        m_reorderStats.maxDepth = std::max(m_reorderStats.maxDepth, depth);
+        for (uint32_t i = m_end; i != pos; --i) {
+            m_buffer[i & HISTORY_MASK] = at(i - 1);
+        }
+    }
+    m_buffer[pos & HISTORY_MASK] = toSample(state);
+    ++m_end;
+    m_newData = true;
+
+    // Trim old states to keep only the last 1 second of data
+    const int64_t MAX_HISTORY_MS = 1000;
+    const int64_t newestTime = back().timestamp;
+
+    // Always keep a few states, senders may report only every few seconds
+    const uint32_t MIN_HISTORY_STATES = 4;
+
+    while (size() > MIN_HISTORY_STATES &&
+           (newestTime - front().timestamp) > MAX_HISTORY_MS) {
+        ++m_first;
     }
-    //    LogMsg("Buffer size: %d, %s", m_buffer.size(), output.c_str());
+}
+
+//------------------------------------------------------------------------------
+// Anchor
+//------------------------------------------------------------------------------
+void Interpolator::Anchor::Set(double _lat, double _lon, double _el) {
+    lat = _lat;
+    lon = _lon;
+    el = _el;
+    mPerDegLon = M_PER_DEG_LAT * std::max(std::cos(deg2rad(_lat)), 1e-6);
+}
+
+Interpolator::LocalState
+Interpolator::Anchor::ToLocal(const EntityState &state) const {
+    return {float(std::remainder(state.lon - lon, 360.0) * mPerDegLon),
+            float((state.lat - lat) * M_PER_DEG_LAT),
+            float(state.el - el),
+            float(state.pitch),
+            float(state.roll),
+            float(state.heading)};
+}
+
+Interpolator::EntityState
+Interpolator::Anchor::ToGeo(const LocalState &local, int64_t time) const {
+    EntityState state;
+    state.timestamp = time;
+    state.lat = lat + double(local.north) / M_PER_DEG_LAT;
+    state.lon = std::remainder(lon + double(local.east) / mPerDegLon, 360.0);
+    state.el = el + double(local.up);
+    state.pitch = local.pitch;
+    state.roll = std::remainder(double(local.roll), 360.0);
+    state.heading = NormalizeHeading(local.heading);
+    return state;
+}
+
+//------------------------------------------------------------------------------
+// toSample / toLocal
+//------------------------------------------------------------------------------
+static int16_t PackAngle(double deg) {
+    return int16_t(std::lround(std::remainder(deg, 360.0) * 100.0));
+}
+
+Interpolator::Sample Interpolator::toSample(const EntityState &state) const {
+    static_assert(sizeof(Sample) * 2 <= sizeof(EntityState) + 8,
+                  "buffered samples should take about half the space");
+    const LocalState local = m_anchor.ToLocal(state);
+    return {state.timestamp,      local.east,
+            local.north,          local.up,
+            PackAngle(state.pitch), PackAngle(state.roll),
+            PackAngle(state.heading)};
+}
+
+Interpolator::LocalState Interpolator::toLocal(const Sample &sample) const {
+    return {sample.east,          sample.north,
+            sample.up,            sample.pitch / 100.0f,
+            sample.roll / 100.0f, sample.heading / 100.0f};
+}
+
+//------------------------------------------------------------------------------
+// rebase
+//------------------------------------------------------------------------------
+void Interpolator::rebase(const EntityState &state) {
+    const Anchor old = m_anchor;
+    m_anchor.Set(state.lat, state.lon, state.el);
+    for (uint32_t i = m_first; i != m_end; ++i) {
+        Sample &sample = m_buffer[i & HISTORY_MASK];
+        const LocalState local = toLocal(sample);
+        const EntityState geo = old.ToGeo(local, sample.timestamp);
+        const LocalState moved = m_anchor.ToLocal(geo);
+        sample.east = moved.east;
+        sample.north = moved.north;
+        sample.up = moved.up;
+    }
+}
+
+//------------------------------------------------------------------------------
+// findBracket
+//------------------------------------------------------------------------------
+uint32_t Interpolator::findBracket(int64_t renderTime) {
+    // Common case: same bracket as last time, or the next one.
+    // Unsigned differences also reject brackets trimmed away meanwhile.
+    for (uint32_t i = m_bracket; i <= m_bracket + 1; ++i) {
+        if (i - m_first < size() - 1 && at(i).timestamp <= renderTime &&
+            renderTime < at(i + 1).timestamp) {
+            return m_bracket = i;
+        }
+    }
+
+    // Binary search for the last state not after renderTime.
+    // front() <= renderTime < back() holds, see getInterpolatedState
+    uint32_t lo = m_first, hi = m_end - 1;
+    while (hi - lo > 1) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        if (at(mid).timestamp <= renderTime) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return m_bracket = lo;
 }
 
 //------------------------------------------------------------------------------
@@ -70,67 +227,262 @@ void Interpolator::addState(const EntityState &state) {
 //------------------------------------------------------------------------------
 Interpolator::EntityState
 Interpolator::getInterpolatedState(int64_t renderTime) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    Blend blend;
+    getBlend(renderTime, blend);
+    return Evaluate(blend, renderTime);
+}
+
+//------------------------------------------------------------------------------
+// getBlend
+//------------------------------------------------------------------------------
+void Interpolator::getBlend(int64_t renderTime, Blend &blend) {
+    // Position errors beyond this are a teleport rather than late data
+    const float SNAP_DISTANCE_M = 1000.0f;
+
+    if (m_newData && m_hasShown) {
+        // How far does the new data move the target away from what is on
+        // screen? Start converging from there.
+        const LocalState shown =
+            m_anchor.ToLocal(Evaluate(m_shown, m_shownTime));
+        Blend now;
+        blendAt(m_shownTime, now);
+        const LocalState target =
+            m_anchor.ToLocal(Evaluate(now, m_shownTime));
+
+        m_correction.east = shown.east - target.east;
+        m_correction.north = shown.north - target.north;
+        m_correction.up = shown.up - target.up;
+        m_correction.pitch = shown.pitch - target.pitch;
+        m_correction.roll = std::remainder(shown.roll - target.roll, 360.0f);
+        m_correction.heading =
+            std::remainder(shown.heading - target.heading, 360.0f);
+        m_correctionTime = m_shownTime;
+        m_correcting =
+            Config::GetInstance()->convergenceMs > 0 &&
+            std::hypot(m_correction.east, m_correction.north) < SNAP_DISTANCE_M;
+    }
+    m_newData = false;
+
+    blendAt(renderTime, blend);
+    // Counted here, blendAt also runs for the convergence target above
+    if (size() > 1 && renderTime - back().timestamp >
+                          Config::GetInstance()->extrapolationHorizonMs) {
+        ++m_lateFrames; // logged in summary by AppState
+    }
+
+    if (m_correcting) {
+        const float decay = float(std::exp(
+            -double(renderTime - m_correctionTime) /
+            double(Config::GetInstance()->convergenceMs)));
+        if (decay < 0.001f) {
+            m_correcting = false; // converged
+        } else {
+            // Shifting all points shifts the blend by the same amount
+            for (LocalState &p : blend.points) {
+                p.east += m_correction.east * decay;
+                p.north += m_correction.north * decay;
+                p.up += m_correction.up * decay;
+                p.pitch += m_correction.pitch * decay;
+                p.roll += m_correction.roll * decay;
+                p.heading += m_correction.heading * decay;
+            }
+        }
+    }
+
+    m_shown = blend;
+    m_shownTime = renderTime;
+    m_hasShown = true;
+}
+
+//------------------------------------------------------------------------------
+// blendAt
+//------------------------------------------------------------------------------
+void Interpolator::blendAt(int64_t renderTime, Blend &blend) {
+    LocalState *p = blend.points;
+    float *w = blend.weights;
+    w[0] = w[1] = w[2] = w[3] = 0.0f;
+    blend.anchor = m_anchor;
 
     // If no data in the buffer, return a default object
-    if (m_buffer.empty()) {
-        return {renderTime, 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (size() == 0) {
+        p[0] = p[1] = p[2] = p[3] = {};
+        return;
     }
 
     // If we only have one state or if renderTime is before the first
-    if (m_buffer.size() == 1 || renderTime <= m_buffer.front().timestamp) {
-        return m_buffer.front();
-    }
-
-    // If renderTime is beyond the latest known state, we can:
-    // (A) Return the last state
-    // (B) Or do short extrapolation
-    if (renderTime >= m_buffer.back().timestamp) {
-        // Return the last known state (simple approach)
-        LogMsg("WARNING: network dealy!!! - render time: %lld, latest ts: %lld, delta: %lld", renderTime,
-               m_buffer.back().timestamp,
-               renderTime - m_buffer.back().timestamp);
-        return m_buffer.back();
-
-        // or short extrapolation, e.g.:
-        /*
-        const auto& last = m_buffer.back();
-        double dt = renderTime - last.timestamp;
-        EntityState extrap = last;
-        extrap.timestamp = renderTime;Buffer size
-        // naive extrap (heading-based) for demonstration:
-        double rad = last.heading * (3.14159265358979 / 180.0); // if heading in
-        degrees extrap.x += last.groundSpeed * std::cos(rad) * dt; extrap.lon +=
-        last.groundSpeed * std::sin(rad) * dt;
-        // handle vertical speed if relevant
-        return extrap;
-        */
-    }
-
-    // Otherwise, find the two states that bracket "renderTime"
-    // We know times are strictly increasing, so we can do a simple linear scan
-    // or use std::lower_bound. For small buffers, a linear scan is fine.
-    for (size_t i = 0; i < m_buffer.size() - 1; ++i) {
-        const auto &sA = m_buffer[i];
-        const auto &sB = m_buffer[i + 1];
-        if (renderTime >= sA.timestamp && renderTime <= sB.timestamp) {
-            // Interpolate
-            double total = sB.timestamp - sA.timestamp;
-            double portion = renderTime - sA.timestamp;
-            double t = (total > 0.000001) ? (portion / total) : 0.0;
-
-            EntityState interp;
-            interp.timestamp = renderTime;
-            interp.lat = sA.lat + (sB.lat - sA.lat) * t;
-            interp.lon = sA.lon + (sB.lon - sA.lon) * t;
-            interp.el = sA.el + (sB.el - sA.el) * t;
-            interp.pitch = sA.pitch + (sB.pitch - sA.pitch) * t;
-            interp.roll = sA.roll + (sB.roll - sA.roll) * t;
-            interp.heading = sA.heading + (sB.heading - sA.heading) * t;
-            return interp;
+    if (size() == 1 || renderTime <= front().timestamp) {
+        p[0] = p[1] = p[2] = p[3] = toLocal(front());
+        return;
+    }
+
+    if (renderTime >= back().timestamp) {
+        // Beyond the latest known state we extrapolate, which is the normal
+        // case for senders that only report on change
+        const int64_t horizon = Config::GetInstance()->extrapolationHorizonMs;
+        // Along a curve, so no blend of the buffered states: all points
+        // are the result
+        const Sample &prev = at(m_end - 2);
+        const Sample &last = back();
+        p[0] = p[1] = p[2] = p[3] = m_anchor.ToLocal(Extrapolate(
+            m_anchor.ToGeo(toLocal(prev), prev.timestamp),
+            m_anchor.ToGeo(toLocal(last), last.timestamp), renderTime,
+            horizon));
+    } else {
+        // Otherwise, interpolate between the two states bracketing it,
+        // with their neighbours if there are any
+        const uint32_t i = findBracket(renderTime);
+        const int64_t t1 = at(i).timestamp;
+        const int64_t t2 = at(i + 1).timestamp;
+        const int64_t t0 = i != m_first ? at(i - 1).timestamp : t1;
+        const int64_t t3 = i + 2 != m_end ? at(i + 2).timestamp : t2;
+        p[1] = toLocal(at(i));
+        p[2] = toLocal(at(i + 1));
+        p[0] = i != m_first ? toLocal(at(i - 1)) : p[1];
+        p[3] = i + 2 != m_end ? toLocal(at(i + 2)) : p[2];
+
+        const double dt = double(t2 - t1);
+        const double s = double(renderTime - t1) / dt;
+        if (!Config::GetInstance()->interpolationHermite) {
+            w[2] = float(s);
+        } else {
+            // Cubic Hermite with Catmull-Rom tangents from the neighbours,
+            // which become one-sided differences at the ends of the buffer.
+            // Tangents are scaled to the bracket interval, as timestamps
+            // aren't evenly spaced.
+            const double k1 = dt / double(t2 - t0);
+            const double k2 = dt / double(t3 - t1);
+            const double s2 = s * s, s3 = s2 * s;
+            const double h10 = s3 - 2.0 * s2 + s;
+            const double h01 = -2.0 * s3 + 3.0 * s2;
+            const double h11 = s3 - s2;
+            w[0] = float(-h10 * k1);
+            w[2] = float(h10 * k1 + h01);
+            w[3] = float(h11 * k2);
         }
     }
 
-    // Should never get here if the buffer is consistent, but just in case:
-    return m_buffer.back();
+    // Heading (and roll in aerobatics) may wrap, blend the short way
+    for (int k : {0, 2, 3}) {
+        p[k].heading = p[1].heading +
+                       std::remainder(p[k].heading - p[1].heading, 360.0f);
+        p[k].roll = p[1].roll + std::remainder(p[k].roll - p[1].roll, 360.0f);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Evaluate
+//------------------------------------------------------------------------------
+Interpolator::LocalState Interpolator::EvaluateLocal(const Blend &blend) {
+    const LocalState *p = blend.points;
+    const float *w = blend.weights;
+    // Same operations in the same order as PoseBatch's kernels
+    auto field = [&](float LocalState::*f) {
+        return p[1].*f + w[0] * (p[0].*f - p[1].*f) +
+               w[2] * (p[2].*f - p[1].*f) + w[3] * (p[3].*f - p[1].*f);
+    };
+    return {field(&LocalState::east),  field(&LocalState::north),
+            field(&LocalState::up),    field(&LocalState::pitch),
+            field(&LocalState::roll),  field(&LocalState::heading)};
+}
+
+Interpolator::EntityState Interpolator::Evaluate(const Blend &blend,
+                                                 int64_t time) {
+    return blend.anchor.ToGeo(EvaluateLocal(blend), time);
+}
+
+//------------------------------------------------------------------------------
+// NormalizeHeading
+//------------------------------------------------------------------------------
+double Interpolator::NormalizeHeading(double heading) {
+    heading = std::fmod(heading, 360.0);
+    return heading < 0.0 ? heading + 360.0 : heading;
+}
+
+//------------------------------------------------------------------------------
+// Extrapolate
+//------------------------------------------------------------------------------
+Interpolator::EntityState Interpolator::Extrapolate(const EntityState &prev,
+                                                    const EntityState &last,
+                                                    int64_t time,
+                                                    int64_t horizonMs) {
+    // Turn rates beyond this are noise, not a turn [deg/s]
+    const double MAX_TURN_RATE = 10.0;
+
+    const double dt = double(last.timestamp - prev.timestamp);
+    if (dt <= 0.0 || time <= last.timestamp) {
+        return last;
+    }
+    const double tau = double(std::min(time - last.timestamp, horizonMs));
+
+    // Velocity in a locally isotropic frame [deg of latitude / ms]
+    const double cosLat = std::max(std::cos(deg2rad(last.lat)), 1e-6);
+    const double vEast =
+        std::remainder(last.lon - prev.lon, 360.0) * cosLat / dt;
+    const double vNorth = (last.lat - prev.lat) / dt;
+
+    // Heading may cross north, turn the short way [deg/ms]
+    const double turnMax = MAX_TURN_RATE / 1000.0;
+    const double turn = std::clamp(
+        std::remainder(last.heading - prev.heading, 360.0) / dt, -turnMax,
+        turnMax);
+
+    // Integrate the velocity turning clockwise at `turn` over `tau`
+    double s = tau, c = 0.0;
+    const double omega = deg2rad(turn);
+    if (std::abs(omega) > 1e-12) {
+        s = std::sin(omega * tau) / omega;
+        c = (1.0 - std::cos(omega * tau)) / omega;
+    }
+    const double dEast = vEast * s + vNorth * c;
+    const double dNorth = vNorth * s - vEast * c;
+
+    EntityState extrap;
+    extrap.timestamp = time;
+    extrap.lat = last.lat + dNorth;
+    extrap.lon = last.lon + dEast / cosLat;
+    extrap.el = last.el + (last.el - prev.el) * tau / dt;
+    extrap.pitch = last.pitch;
+    extrap.roll = last.roll;
+    extrap.heading = NormalizeHeading(last.heading + turn * tau);
+    return extrap;
+}
+
+//------------------------------------------------------------------------------
+// Reset
+//------------------------------------------------------------------------------
+void Interpolator::Reset() {
+    // Same as the member initializers
+    m_anchor = Anchor();
+    m_first = m_end = m_bracket = 0;
+    m_shown = Blend();
+    m_shownTime = 0;
+    m_hasShown = false;
+    m_newData = false;
+    m_correction = {};
+    m_correctionTime = 0;
+    m_correcting = false;
+    m_lateFrames = 0;
+    m_transitCount = 0;
+    m_lagTarget = m_lag = 0.0;
+    m_lagTime = 0;
+    m_hasLag = false;
+    m_reorderStats = {};
+}
+
+//------------------------------------------------------------------------------
+// TakeReorderStats
+//------------------------------------------------------------------------------
+Interpolator::ReorderStats Interpolator::TakeReorderStats() {
+    const ReorderStats stats = m_reorderStats;
+    m_reorderStats = {};
+    return stats;
+}
+
+//------------------------------------------------------------------------------
+// TakeLateFrames
+//------------------------------------------------------------------------------
+uint32_t Interpolator::TakeLateFrames() {
+    const uint32_t lateFrames = m_lateFrames;
+    m_lateFrames = 0;
+    return lateFrames;
 }
@@ -8,12 +8,10 @@
 #ifndef INTERPOLATOR_H
 #define INTERPOLATOR_H
 
-#include <deque>
-#include <string>
-#include <mutex>
-#include <algorithm> // for std::lower_bound (if needed)
+#include <algorithm>
+#include <cstdint>
 
-#include "util.h"
+#include "common.h"
 
 class Interpolator
 {
@@ -30,27 +28,172 @@ public:
         double roll;
     };
 
-    Interpolator(int64_t);
+    // A state in the local frame of an Anchor: offsets in the plane tangent
+    // to the earth at the anchor, east-north-up, plus attitude
+    struct LocalState
+    {
+        float east;    // [m]
+        float north;   // [m]
+        float up;      // [m]
+        float pitch;   // [deg]
+        float roll;    // [deg], may be unwrapped beyond -180..180
+        float heading; // [deg], may be unwrapped beyond 0..360
+    };
+
+    // Fixes a local frame to the earth near an aircraft, so that its
+    // positions fit into floats
+    struct Anchor
+    {
+        double lat = 0.0;
+        double lon = 0.0;
+        double el = 0.0;
+        double mPerDegLon = M_PER_DEG_LAT;
+
+        void Set(double lat, double lon, double el);
+        LocalState ToLocal(const EntityState& state) const;
+        EntityState ToGeo(const LocalState& local, int64_t time) const;
+    };
+
+    Interpolator() = default;
     ~Interpolator() = default;
 
     // Delete copy semantics to ensure only one instance
     Interpolator(const Interpolator&) = delete;
     Interpolator& operator=(const Interpolator&) = delete;
 
-    // Called whenever you receive a new WebSocket message containing an EntityState
-    void OnWebSocketMessage(const std::string& msg);
+    // Back to the state of a new Interpolator, for reusing it for another
+    // aircraft. Leaves the buffers' contents, they are dead data then.
+    void Reset();
+
+    // Called on the sim thread for every EntityState decoded from the network,
+    // with the server time in ms it arrived at, as per ServerClock.
+    // The interpolator is only ever used by the sim thread, so needs no lock.
+    void OnPosReport(const EntityState& state, int64_t arrivalMs);
+
+    // Server time to render at, for the server time `nowMs`.
+    // Lags behind by this peer's transit time plus a playout delay that
+    // adapts to its jitter, see Config::jitterPercentile.
+    int64_t getRenderTime(int64_t nowMs);
 
     // Get interpolated state at a given renderTime
     EntityState getInterpolatedState(int64_t renderTime);
-    int64_t serverTimeOffset;
+
+    // The state at some time as a weighted blend of up to 4 buffered states:
+    // `points[1] + sum of weights[k] * (points[k] - points[1])`, per field,
+    // in the local frame of `anchor`.
+    // Linear blends only weigh points[2]; weights above 1 extrapolate.
+    // Headings and rolls are unwrapped around points[1], so that blending
+    // them takes the short way.
+    struct Blend
+    {
+        LocalState points[4];
+        float weights[4]; // weights[1] is always 0
+        Anchor anchor;
+    };
+
+    // Lets PoseBatch blend all planes in one pass. Meant to be called once
+    // per frame: when late data moves the target, the blend converges to it
+    // from what the last call returned instead of snapping.
+    void getBlend(int64_t renderTime, Blend& blend);
+    // Computes the state `blend` describes, in its local frame...
+    static LocalState EvaluateLocal(const Blend& blend);
+    // ...and on the globe
+    static EntityState Evaluate(const Blend& blend, int64_t time);
+
+    // Dead-reckoning model shared by the receivers and our own send gate:
+    // continues from `last` to `time`, but at most `horizonMs` past `last`,
+    // with the velocity, climb rate and turn rate from `prev` to `last`.
+    // The track curves with the heading, pitch and roll are held.
+    static EntityState Extrapolate(const EntityState& prev,
+                                   const EntityState& last, int64_t time,
+                                   int64_t horizonMs);
+    // Maps any heading into 0..360
+    static double NormalizeHeading(double heading);
+    // Frames rendered further than the extrapolation horizon past the
+    // latest state since the last call
+    uint32_t TakeLateFrames();
+
+    // What OnPosReport saw of reordering, since the last call
+    struct ReorderStats
+    {
+        uint32_t reordered = 0;  // inserted before newer states
+        uint32_t maxDepth = 0;   // by how many states, at most
+        uint32_t duplicates = 0; // dropped, timestamp already known
+        uint32_t tooLate = 0;    // dropped, older than the reorder window
+    };
+    ReorderStats TakeReorderStats();
 
 private:
-    std::deque<EntityState> m_buffer;   // Time-sorted buffer of states
-    std::mutex m_mutex;                 // Protects m_buffer from concurrent access
-    
+    // A buffered state, compact: 32 instead of 56 bytes
+    struct Sample
+    {
+        int64_t timestamp;
+        float east, north, up;          // [m] from m_anchor
+        int16_t pitch, roll, heading;   // [0.01 deg], -180..180
+    };
+
+    // Frame of the buffered samples, moved when the aircraft gets too far
+    // from it for float precision
+    Anchor m_anchor;
+    Sample toSample(const EntityState& state) const;
+    LocalState toLocal(const Sample& sample) const;
+    // Moves m_anchor to `state`, converting the buffered samples
+    void rebase(const EntityState& state);
+
+    // Capacity of the state history, a power of two
+    static constexpr uint32_t HISTORY_CAPACITY = 32;
+    static constexpr uint32_t HISTORY_MASK = HISTORY_CAPACITY - 1;
+
+    // Time-sorted ring buffer of states. m_first and m_end count up forever,
+    // the states are m_buffer[m_first & HISTORY_MASK .. (m_end - 1) & ...]
+    Sample m_buffer[HISTORY_CAPACITY];
+    uint32_t m_first = 0;
+    uint32_t m_end = 0;
+    // Where the last lookup found its bracket, render time mostly moves on
+    // by less than a report interval between two lookups
+    uint32_t m_bracket = 0;
+
+    uint32_t size() const { return m_end - m_first; }
+    const Sample& at(uint32_t i) const { return m_buffer[i & HISTORY_MASK]; }
+    const Sample& front() const { return at(m_first); }
+    const Sample& back() const { return at(m_end - 1); }
+    // Absolute index i of the state with at(i) <= renderTime < at(i + 1)
+    uint32_t findBracket(int64_t renderTime);
+    // getBlend without convergence and late frame counting
+    void blendAt(int64_t renderTime, Blend& blend);
+
+    // What getBlend returned last time, the pose on screen
+    Blend m_shown;
+    int64_t m_shownTime = 0;
+    bool m_hasShown = false;
+    // A state arrived since the last getBlend
+    bool m_newData = false;
+    // Offset from the target to the pose on screen, as of m_correctionTime,
+    // decaying from there
+    LocalState m_correction = {};
+    int64_t m_correctionTime = 0;
+    bool m_correcting = false;
+    uint32_t m_lateFrames = 0;
+
+    // Transit times (arrival minus server timestamp, both server time, so
+    // including any error of our server clock) of the last reports [ms]
+    static constexpr uint32_t TRANSIT_WINDOW = 64;
+    int64_t m_transit[TRANSIT_WINDOW];
+    uint32_t m_transitCount = 0;
+    // Wanted and current lag of the render time behind local time [ms]
+    double m_lagTarget = 0.0;
+    double m_lag = 0.0;
+    int64_t m_lagTime = 0;
+    bool m_hasLag = false;
+    // Sets m_lagTarget from the transit window
+    void updateLagTarget();
+
+    // States arriving up to this many places out of order are still used
+    static constexpr uint32_t REORDER_WINDOW = 8;
+    ReorderStats m_reorderStats;
 
-    // Helper: Insert new state (already parsed) in a sorted manner or at the back,
-    // ignoring out-of-order data if timestamp < the last stored timestamp.
+    // Helper: Insert new state (already parsed) in a sorted manner, usually
+    // at the back. Drops duplicates and states older than REORDER_WINDOW.
     void addState(const EntityState& state);
 };
 #endif
@@ -0,0 +1,84 @@
+//
+//  lockfree.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef LOCKFREE_H
+#define LOCKFREE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// Hands the latest value from one producer thread to one consumer thread.
+/// A triple buffer: both sides are wait-free, the consumer always gets the
+/// newest complete value and never one that is being written.
+template <typename T> class LatestValue {
+  public:
+    /// Producer: publishes a new value, replacing any unread one
+    void Store(const T &value) {
+        m_buf[m_back] = value;
+        m_back =
+            m_middle.exchange(m_back | DIRTY, std::memory_order_acq_rel) & INDEX;
+    }
+
+    /// Consumer: fetches the newest value
+    /// @return `false` if nothing was stored since the last `Load`
+    bool Load(T &value) {
+        if (!(m_middle.load(std::memory_order_relaxed) & DIRTY)) {
+            return false;
+        }
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        value = m_buf[m_front];
+        return true;
+    }
+
+  private:
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t DIRTY = 4;
+
+    T m_buf[3]{};
+    std::atomic<uint8_t> m_middle{1}; ///< index of the buffer in between
+    uint8_t m_back = 0;               ///< producer's buffer
+    uint8_t m_front = 2;              ///< consumer's buffer
+};
+
+/// Bounded queue from one producer thread to one consumer thread.
+/// Both sides are wait-free, `N` must be a power of two.
+template <typename T, size_t N> class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+  public:
+    /// Producer: appends a value
+    /// @return `false` if the ring is full, `value` is dropped then
+    bool Push(const T &value) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        m_buf[head & (N - 1)] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer: takes the oldest value
+    /// @return `false` if the ring is empty
+    bool Pop(T &value) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = m_buf[tail & (N - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+  private:
+    // Separate cache lines, producer and consumer don't disturb each other
+    alignas(64) std::atomic<size_t> m_head{0}; ///< written by the producer
+    alignas(64) std::atomic<size_t> m_tail{0}; ///< written by the consumer
+    T m_buf[N];
+};
+
+#endif // LOCKFREE_H
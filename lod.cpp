@@ -0,0 +1,20 @@
+//
+//  lod.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+
+#include "lod.h"
+
+LodTier NextLodTier(LodTier current, double distM) {
+    // Boundaries outward of the current tier are pushed out by the hysteresis
+    const double nearM =
+        current > LOD_NEAR ? LOD_NEAR_M : LOD_NEAR_M * LOD_HYSTERESIS;
+    const double midM =
+        current > LOD_MID ? LOD_MID_M : LOD_MID_M * LOD_HYSTERESIS;
+    if (distM < nearM) {
+        return LOD_NEAR;
+    }
+    return distM < midM ? LOD_MID : LOD_FAR;
+}
@@ -0,0 +1,31 @@
+//
+//  lod.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef LOD_H
+#define LOD_H
+
+#include <cstdint>
+
+/// How much update work a remote plane gets, by distance from us
+enum LodTier {
+    LOD_NEAR = 0, ///< pose and animations every frame
+    LOD_MID,      ///< pose at LOD_MID_INTERVAL_MS, animations frozen
+    LOD_FAR,      ///< position only, at LOD_FAR_INTERVAL_MS
+};
+/// Near tier up to this distance, where animations can be made out
+constexpr double LOD_NEAR_M = 5000.0;
+/// Mid tier up to this distance, far tier beyond
+constexpr double LOD_MID_M = 20000.0;
+/// Moving out to a farther tier needs this much more distance than moving
+/// in, so planes at a boundary don't flip tiers every update
+constexpr double LOD_HYSTERESIS = 1.1;
+constexpr int64_t LOD_MID_INTERVAL_MS = 100;
+constexpr int64_t LOD_FAR_INTERVAL_MS = 250;
+
+/// Tier for a plane `distM` away that was in tier `current` so far
+LodTier NextLodTier(LodTier current, double distM);
+
+#endif // LOD_H
@@ -6,6 +6,7 @@
 //
 
 #include "menu.h"
+#include "config.h"
 
 Menu* Menu::instance = nullptr;
 
@@ -27,6 +28,8 @@ void Menu::Initialize() {
     menuID = XPLMCreateMenu("Fly With Me", XPLMFindPluginsMenu(), my_slot,
                            MenuHanlder, NULL);
     XPLMAppendMenuItem(menuID, "Toggle AI control", (void *)MENU_AI, 0);
+    XPLMAppendMenuItem(menuID, "Smooth interpolation", (void *)MENU_HERMITE,
+                       0);
     menuUpdateCheckmarks();
 }
 
@@ -41,6 +44,11 @@ void Menu::MenuHanlder(void *, void *inItemRef) {
                 // control
                 XPMPMultiplayerEnable();
             break;
+
+        case MENU_HERMITE: // Toggle Hermite interpolation
+            Config::GetInstance()->interpolationHermite =
+                !Config::GetInstance()->interpolationHermite;
+            break;
         }
 
         // Update menu items' checkmarks
@@ -52,4 +60,8 @@ void Menu::menuUpdateCheckmarks() {
     XPLMCheckMenuItem(menuID, MENU_AI,
                       XPMPHasControlOfAIAircraft() ? xplm_Menu_Checked
                                                    : xplm_Menu_Unchecked);
+    XPLMCheckMenuItem(menuID, MENU_HERMITE,
+                      Config::GetInstance()->interpolationHermite
+                          ? xplm_Menu_Checked
+                          : xplm_Menu_Unchecked);
 }
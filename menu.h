@@ -20,6 +20,7 @@
 
 enum MenuItems {
     MENU_AI=0,                ///< Menu Item "Toggle AI control"
+    MENU_HERMITE,             ///< Menu Item "Smooth interpolation"
 };
 
 class Menu final {
@@ -28,11 +29,11 @@ public:
     void Initialize();
     void Deinitialize();
     static void MenuHanlder(void * /*inMenuRef*/, void *inItemRef);
+    void menuUpdateCheckmarks();
     
 private:
     Menu();
     ~Menu();
-    void menuUpdateCheckmarks();
     static Menu* instance;
     XPLMMenuID menuID = nullptr;
 };
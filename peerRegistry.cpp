@@ -0,0 +1,99 @@
+//
+//  peerRegistry.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+
+#include "peerRegistry.h"
+
+static_assert((2 * MAX_PEERS & (2 * MAX_PEERS - 1)) == 0,
+              "hash capacity must be a power of two");
+
+PeerRegistry::PeerRegistry() : m_slots(new NetworkAircraft[MAX_PEERS]) {}
+
+// FNV-1a, client IDs are short
+uint32_t PeerRegistry::Hash(std::string_view clientId) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : clientId) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
+}
+
+NetworkAircraft *PeerRegistry::Find(std::string_view clientId) {
+    uint32_t hash = Hash(clientId);
+    for (uint32_t i = hash & (HASH_CAPACITY - 1);;
+         i = (i + 1) & (HASH_CAPACITY - 1)) {
+        const Bucket &bucket = m_buckets[i];
+        if (bucket.slot == EMPTY) {
+            return nullptr;
+        }
+        if (bucket.hash == hash && m_slots[bucket.slot].clientId == clientId) {
+            return &m_slots[bucket.slot];
+        }
+    }
+}
+
+NetworkAircraft *PeerRegistry::Add(std::string_view clientId) {
+    uint16_t slot;
+    if (!m_released.Pop(slot)) {
+        if (m_count >= MAX_PEERS) {
+            return nullptr;
+        }
+        slot = m_count++;
+    }
+    uint32_t hash = Hash(clientId);
+    uint32_t i = hash & (HASH_CAPACITY - 1);
+    // Load factor stays <= 0.5, so there always is an empty bucket
+    while (m_buckets[i].slot != EMPTY) {
+        i = (i + 1) & (HASH_CAPACITY - 1);
+    }
+    m_buckets[i] = {hash, slot};
+
+    NetworkAircraft &peer = m_slots[slot];
+    peer.clientId = clientId;
+    peer.deltaDecoder = DeltaDecoder();
+    peer.lastArrivalMs = 0;
+    return &peer;
+}
+
+void PeerRegistry::Remove(NetworkAircraft &peer) {
+    const uint16_t slot = SlotOf(peer);
+    uint32_t i = Hash(peer.clientId) & (HASH_CAPACITY - 1);
+    while (m_buckets[i].slot != slot) {
+        i = (i + 1) & (HASH_CAPACITY - 1);
+    }
+    // Pull later buckets of the probe run into the hole, unless that would
+    // move them before their home bucket
+    for (uint32_t j = i;;) {
+        j = (j + 1) & (HASH_CAPACITY - 1);
+        if (m_buckets[j].slot == EMPTY) {
+            break;
+        }
+        const uint32_t home = m_buckets[j].hash & (HASH_CAPACITY - 1);
+        if (((j - home) & (HASH_CAPACITY - 1)) <
+            ((j - i) & (HASH_CAPACITY - 1))) {
+            continue; // home is between the hole and j
+        }
+        m_buckets[i] = m_buckets[j];
+        i = j;
+    }
+    m_buckets[i] = Bucket();
+
+    peer.state.store(SLOT_LEAVING, std::memory_order_release);
+}
+
+void PeerRegistry::Release(uint16_t slot) {
+    NetworkAircraft &peer = m_slots[slot];
+    // Nothing gets pushed any more, drop what's left
+    InboundState in;
+    while (peer.inbound.Pop(in)) {
+    }
+    peer.config.Load(peer.lastConfig);
+    peer.lastConfig = AircraftConfig();
+    peer.lastReportMs = 0;
+    peer.interpolator.Reset();
+    peer.state.store(SLOT_FREE, std::memory_order_relaxed);
+    m_released.Push(slot); // can't be full, it has room for all slots
+}
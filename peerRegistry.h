@@ -0,0 +1,126 @@
+//
+//  peerRegistry.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef PEER_REGISTRY_H
+#define PEER_REGISTRY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "interpolator.h"
+#include "lockfree.h"
+#include "lod.h"
+#include "protocol.h"
+
+class RemoteAircraft;
+
+/// Most remote clients we track at the same time
+constexpr uint16_t MAX_PEERS = 1024;
+/// Capacity of a peer's inbound queue, ~3s of reports at 20 Hz
+constexpr size_t PEER_INBOUND_CAPACITY = 64;
+
+/// Life cycle of a `NetworkAircraft` slot
+enum SlotState : uint8_t {
+    SLOT_FREE = 0, ///< unused, or being set up by the asio thread
+    SLOT_ACTIVE,   ///< client known, fed by the asio thread
+    SLOT_LEAVING,  ///< client forgotten by the asio thread, the sim thread
+                   ///< tears the slot down and hands it back
+};
+
+/// A decoded state and the server time in ms it arrived at
+struct InboundState {
+    Interpolator::EntityState state;
+    int64_t arrivalMs;
+};
+
+/// One slot of the registry. Slots are reused for new clients, so
+/// everything a client needs lives in it or, for the XPMP2 aircraft, in the
+/// slot of the same number of `AppState`'s plane slab.
+struct NetworkAircraft {
+    std::string clientId;
+    // `SlotState`, set by the asio thread except for LEAVING -> FREE
+    std::atomic<uint8_t> state{SLOT_FREE};
+    // Only while the client reports fresh data, sim thread only.
+    // Constructed in `AppState`'s plane slab when set.
+    RemoteAircraft *remotePlane = nullptr;
+    LodTier lod = LOD_NEAR;                // sim thread only
+    int64_t lodNextMs = 0; // sim thread only, when the pose is due next
+    // Sim thread only: distance measured by LOD round `lodRound`, see
+    // `AppState::InboundLoopCallback`
+    uint32_t lodRound = 0;
+    double lodDistM = 0.0;
+    int64_t lastReportMs = 0; // sim thread only, server time
+    AircraftConfig lastConfig; // sim thread only, for the next remotePlane
+    Interpolator interpolator; // sim thread only, reset on release
+    DeltaDecoder deltaDecoder;             // asio thread only
+    int64_t lastArrivalMs = 0; // asio thread only, ServerClock::LocalNow()
+    // Decoded states, from the asio thread to the sim thread
+    SpscRing<InboundState, PEER_INBOUND_CAPACITY> inbound;
+    // Latest configuration, from the asio thread to the sim thread
+    LatestValue<AircraftConfig> config;
+};
+
+/// Interns client IDs into slots `0..Count()-1` of a contiguous
+/// `NetworkAircraft` array, found through a flat open-addressing hash.
+/// The asio thread owns the hash, adds peers and removes them again; the
+/// sim thread iterates the published slots and hands the slots of removed
+/// peers back for reuse. Nothing allocates after `Add` except the ID copy.
+class PeerRegistry {
+  public:
+    PeerRegistry();
+
+    /// asio thread: slot of a known client
+    /// @return `nullptr` if the client is not known yet
+    NetworkAircraft *Find(std::string_view clientId);
+    /// asio thread: takes a free slot for a new client, preferring slots
+    /// handed back over never used ones.
+    /// The slot is invisible to the sim thread until `Publish` is called.
+    /// @return `nullptr` if all `MAX_PEERS` slots are taken
+    NetworkAircraft *Add(std::string_view clientId);
+    /// asio thread: makes a slot set up after `Add` visible to the sim thread
+    void Publish(NetworkAircraft &peer) {
+        peer.state.store(SLOT_ACTIVE, std::memory_order_release);
+        m_published.store(m_count, std::memory_order_release);
+    }
+    /// asio thread: forgets the client of an active slot, and leaves the
+    /// slot to the sim thread to tear down
+    void Remove(NetworkAircraft &peer);
+    /// Sim thread: tears down a `SLOT_LEAVING` slot, whose `remotePlane` is
+    /// gone already, and frees it for reuse
+    void Release(uint16_t slot);
+
+    /// Number of slots that may be in use, the sim thread looks at these
+    uint16_t Count() const {
+        return m_published.load(std::memory_order_acquire);
+    }
+    NetworkAircraft &operator[](uint16_t slot) { return m_slots[slot]; }
+    uint16_t SlotOf(const NetworkAircraft &peer) const {
+        return uint16_t(&peer - m_slots.get());
+    }
+
+  private:
+    // Twice the slots keeps probe sequences short
+    static constexpr uint32_t HASH_CAPACITY = 2 * MAX_PEERS;
+    static constexpr uint16_t EMPTY = UINT16_MAX;
+    struct Bucket {
+        uint32_t hash;
+        uint16_t slot = EMPTY;
+    };
+
+    static uint32_t Hash(std::string_view clientId);
+
+    std::unique_ptr<NetworkAircraft[]> m_slots;
+    Bucket m_buckets[HASH_CAPACITY];
+    uint16_t m_count = 0; // asio thread only, slots ever used
+    // Released slots, from the sim thread to the asio thread
+    SpscRing<uint16_t, MAX_PEERS> m_released;
+    std::atomic<uint16_t> m_published{0};
+};
+
+#endif // PEER_REGISTRY_H
@@ -0,0 +1,170 @@
+//
+//  poseBatch.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+
+#include "poseBatch.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define POSE_BATCH_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX
+#else
+#define TARGET_AVX __attribute__((target("avx")))
+#endif
+#else
+#define POSE_BATCH_X86 0
+#endif
+
+// out = p1 + w0 * (p0 - p1) + w2 * (p2 - p1) + w3 * (p3 - p1),
+// for n a multiple of 8.
+// All kernels use the same operations in the same order (no FMA), so they
+// produce bit-identical results.
+using BlendKernel = void (*)(size_t n, const float *const w[3],
+                             const float *const p[4], float *out);
+
+static void BlendScalar(size_t n, const float *const w[3],
+                        const float *const p[4], float *out) {
+    for (size_t i = 0; i < n; ++i) {
+        const float p1 = p[1][i];
+        out[i] = p1 + w[0][i] * (p[0][i] - p1) + w[1][i] * (p[2][i] - p1) +
+                 w[2][i] * (p[3][i] - p1);
+    }
+}
+
+#if POSE_BATCH_X86
+static void BlendSse2(size_t n, const float *const w[3],
+                      const float *const p[4], float *out) {
+    for (size_t i = 0; i < n; i += 4) {
+        const __m128 p1 = _mm_load_ps(p[1] + i);
+        __m128 r = _mm_add_ps(
+            p1, _mm_mul_ps(_mm_load_ps(w[0] + i),
+                           _mm_sub_ps(_mm_load_ps(p[0] + i), p1)));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(w[1] + i),
+                                     _mm_sub_ps(_mm_load_ps(p[2] + i), p1)));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(w[2] + i),
+                                     _mm_sub_ps(_mm_load_ps(p[3] + i), p1)));
+        _mm_store_ps(out + i, r);
+    }
+}
+
+TARGET_AVX static void BlendAvx(size_t n, const float *const w[3],
+                                const float *const p[4], float *out) {
+    for (size_t i = 0; i < n; i += 8) {
+        const __m256 p1 = _mm256_load_ps(p[1] + i);
+        __m256 r = _mm256_add_ps(
+            p1, _mm256_mul_ps(_mm256_load_ps(w[0] + i),
+                              _mm256_sub_ps(_mm256_load_ps(p[0] + i), p1)));
+        r = _mm256_add_ps(
+            r, _mm256_mul_ps(_mm256_load_ps(w[1] + i),
+                             _mm256_sub_ps(_mm256_load_ps(p[2] + i), p1)));
+        r = _mm256_add_ps(
+            r, _mm256_mul_ps(_mm256_load_ps(w[2] + i),
+                             _mm256_sub_ps(_mm256_load_ps(p[3] + i), p1)));
+        _mm256_store_ps(out + i, r);
+    }
+}
+
+static bool CpuHasAvx() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    const bool osxsave = info[2] & (1 << 27);
+    const bool avx = info[2] & (1 << 28);
+    // The OS must save the YMM registers on context switches, too
+    return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+    return __builtin_cpu_supports("avx");
+#endif
+}
+#endif
+
+struct KernelChoice {
+    BlendKernel kernel;
+    const char *name;
+};
+
+static KernelChoice SelectKernel() {
+#if POSE_BATCH_X86
+    if (CpuHasAvx()) {
+        return {BlendAvx, "AVX"};
+    }
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    return {BlendSse2, "SSE2"};
+#endif
+#endif
+    return {BlendScalar, "scalar"};
+}
+
+static const KernelChoice &Kernel() {
+    static const KernelChoice choice = SelectKernel();
+    return choice;
+}
+
+PoseBatch::PoseBatch() {
+    // Slots beyond the last peer still get blended, keep them defined
+    for (uint16_t slot = 0; slot < MAX_PEERS; ++slot) {
+        Reset(slot);
+    }
+}
+
+void PoseBatch::Reset(uint16_t slot) {
+    m_time[slot] = 0;
+    m_anchor[slot] = Interpolator::Anchor();
+    for (size_t k = 0; k < 3; ++k) {
+        m_weight[k][slot] = 0.0f;
+    }
+    for (size_t f = 0; f < POSE_FIELDS; ++f) {
+        for (size_t k = 0; k < 4; ++k) {
+            m_points[k][f][slot] = 0.0f;
+        }
+        m_out[f][slot] = 0.0f;
+    }
+}
+
+const char *PoseBatch::KernelName() { return Kernel().name; }
+
+void PoseBatch::Gather(uint16_t slot, Interpolator &interpolator,
+                       int64_t time) {
+    Interpolator::Blend blend;
+    interpolator.getBlend(time, blend);
+    m_time[slot] = time;
+    m_anchor[slot] = blend.anchor;
+    m_weight[0][slot] = blend.weights[0];
+    m_weight[1][slot] = blend.weights[2];
+    m_weight[2][slot] = blend.weights[3];
+    for (size_t k = 0; k < 4; ++k) {
+        const Interpolator::LocalState &p = blend.points[k];
+        m_points[k][POSE_EAST][slot] = p.east;
+        m_points[k][POSE_NORTH][slot] = p.north;
+        m_points[k][POSE_UP][slot] = p.up;
+        m_points[k][POSE_PITCH][slot] = p.pitch;
+        m_points[k][POSE_ROLL][slot] = p.roll;
+        m_points[k][POSE_HEADING][slot] = p.heading;
+    }
+}
+
+void PoseBatch::Run(uint16_t count) {
+    const size_t n = (size_t(count) + 7) & ~size_t(7);
+    const BlendKernel kernel = Kernel().kernel;
+    const float *const w[3] = {m_weight[0], m_weight[1], m_weight[2]};
+    for (size_t f = 0; f < POSE_FIELDS; ++f) {
+        const float *const p[4] = {m_points[0][f], m_points[1][f],
+                                   m_points[2][f], m_points[3][f]};
+        kernel(n, w, p, m_out[f]);
+    }
+}
+
+Interpolator::EntityState PoseBatch::Get(uint16_t slot) const {
+    const Interpolator::LocalState local = {
+        m_out[POSE_EAST][slot],  m_out[POSE_NORTH][slot],
+        m_out[POSE_UP][slot],    m_out[POSE_PITCH][slot],
+        m_out[POSE_ROLL][slot],  m_out[POSE_HEADING][slot]};
+    return m_anchor[slot].ToGeo(local, m_time[slot]);
+}
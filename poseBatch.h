@@ -0,0 +1,61 @@
+//
+//  poseBatch.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef POSE_BATCH_H
+#define POSE_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "interpolator.h"
+#include "peerRegistry.h"
+
+/// Interpolates the poses of all remote planes in one pass per frame.
+/// Each plane's `Interpolator::Blend` is gathered into structure-of-arrays
+/// form, then one SIMD kernel blends every field of every plane, in floats
+/// relative to the plane's anchor.
+/// `RemoteAircraft::UpdatePosition` only reads its slot afterwards.
+/// Sim thread only.
+class PoseBatch {
+  public:
+    enum Field {
+        POSE_EAST = 0,
+        POSE_NORTH,
+        POSE_UP,
+        POSE_PITCH,
+        POSE_ROLL,
+        POSE_HEADING,
+        POSE_FIELDS
+    };
+
+    PoseBatch();
+
+    /// Name of the kernel picked for this CPU, for the log
+    static const char *KernelName();
+
+    /// Gathers the state of `slot` at `time` from its interpolator
+    void Gather(uint16_t slot, Interpolator &interpolator, int64_t time);
+    /// Forgets the pose of `slot`, `Get` returns timestamp 0 until the next
+    /// `Gather` and `Run`
+    void Reset(uint16_t slot);
+    /// Blends slots `0..count-1`
+    void Run(uint16_t count);
+    /// Result of the last `Run` for `slot`, heading in 0..360
+    Interpolator::EntityState Get(uint16_t slot) const;
+
+  private:
+    // Kernels process 8 floats per step and need no tail handling
+    static_assert(MAX_PEERS % 8 == 0, "MAX_PEERS must be a multiple of 8");
+
+    // Weights of points 0, 2 and 3, see Interpolator::Blend
+    alignas(32) float m_weight[3][MAX_PEERS];
+    alignas(32) float m_points[4][POSE_FIELDS][MAX_PEERS];
+    alignas(32) float m_out[POSE_FIELDS][MAX_PEERS];
+    Interpolator::Anchor m_anchor[MAX_PEERS];
+    int64_t m_time[MAX_PEERS];
+};
+
+#endif // POSE_BATCH_H
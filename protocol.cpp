@@ -0,0 +1,475 @@
+//
+//  protocol.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+
+#include "protocol.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+/// Writes little-endian values into a fixed buffer
+struct ByteWriter {
+    uint8_t *p;
+    uint8_t *end;
+
+    bool fits(size_t n) const { return size_t(end - p) >= n; }
+    void u8(uint8_t v) { *p++ = v; }
+    void u16(uint16_t v) {
+        *p++ = uint8_t(v);
+        *p++ = uint8_t(v >> 8);
+    }
+    void u32(uint32_t v) {
+        for (int i = 0; i < 4; ++i)
+            *p++ = uint8_t(v >> (8 * i));
+    }
+    void u64(uint64_t v) {
+        for (int i = 0; i < 8; ++i)
+            *p++ = uint8_t(v >> (8 * i));
+    }
+    /// Zigzag varint, small values of either sign take few bytes
+    void svarint(int64_t v) {
+        uint64_t u = (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+        while (u >= 0x80) {
+            *p++ = uint8_t(u | 0x80);
+            u >>= 7;
+        }
+        *p++ = uint8_t(u);
+    }
+    void f32(float v) {
+        uint32_t u;
+        std::memcpy(&u, &v, sizeof(u));
+        u32(u);
+    }
+    void f64(double v) {
+        uint64_t u;
+        std::memcpy(&u, &v, sizeof(u));
+        u64(u);
+    }
+};
+
+/// Reads little-endian values from a payload, remembers any overrun
+struct ByteReader {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool ok = true;
+
+    explicit ByteReader(std::string_view in)
+        : p(reinterpret_cast<const uint8_t *>(in.data())), end(p + in.size()) {}
+
+    bool take(size_t n) {
+        ok = ok && size_t(end - p) >= n;
+        return ok;
+    }
+    uint8_t u8() { return take(1) ? *p++ : 0; }
+    uint16_t u16() {
+        if (!take(2))
+            return 0;
+        uint16_t v = uint16_t(p[0] | (p[1] << 8));
+        p += 2;
+        return v;
+    }
+    uint32_t u32() {
+        uint32_t v = 0;
+        if (take(4))
+            for (int i = 0; i < 4; ++i)
+                v |= uint32_t(*p++) << (8 * i);
+        return v;
+    }
+    uint64_t u64() {
+        uint64_t v = 0;
+        if (take(8))
+            for (int i = 0; i < 8; ++i)
+                v |= uint64_t(*p++) << (8 * i);
+        return v;
+    }
+    int64_t svarint() {
+        uint64_t u = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!take(1))
+                return 0;
+            const uint8_t b = *p++;
+            u |= uint64_t(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return int64_t(u >> 1) ^ -int64_t(u & 1);
+        }
+        ok = false; // too long
+        return 0;
+    }
+    float f32() {
+        uint32_t u = u32();
+        float v;
+        std::memcpy(&v, &u, sizeof(v));
+        return v;
+    }
+    double f64() {
+        uint64_t u = u64();
+        double v;
+        std::memcpy(&v, &u, sizeof(v));
+        return v;
+    }
+    std::string_view str(size_t n) {
+        if (!take(n))
+            return std::string_view();
+        std::string_view v(reinterpret_cast<const char *>(p), n);
+        p += n;
+        return v;
+    }
+};
+
+/// Cuts the next `delimiter`-separated field off the front of `in`
+static bool NextField(std::string_view &in, std::string_view &field,
+                      char delimiter = ',') {
+    if (in.data() == nullptr)
+        return false;
+    const size_t pos = in.find(delimiter);
+    if (pos == std::string_view::npos) {
+        field = in;
+        in = std::string_view(); // no more fields after this one
+    } else {
+        field = in.substr(0, pos);
+        in.remove_prefix(pos + 1);
+    }
+    return true;
+}
+
+static bool ParseField(std::string_view field, int64_t &val) {
+    const char *end = field.data() + field.size();
+    auto res = std::from_chars(field.data(), end, val);
+    if (res.ec != std::errc() || res.ptr == field.data())
+        return false;
+    // Older servers sent the timestamp as a float, accept and drop fractions
+    return res.ptr == end || *res.ptr == '.';
+}
+
+static bool ParseField(std::string_view field, double &val) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const char *end = field.data() + field.size();
+    auto res = std::from_chars(field.data(), end, val);
+    return res.ec == std::errc() && res.ptr == end && res.ptr != field.data();
+#else
+    // No floating point from_chars in this standard library (e.g. older
+    // libc++), fall back to strtod on a zero-terminated stack copy
+    char buf[64];
+    if (field.empty() || field.size() >= sizeof(buf))
+        return false;
+    std::memcpy(buf, field.data(), field.size());
+    buf[field.size()] = 0;
+    char *end = nullptr;
+    val = std::strtod(buf, &end);
+    return end == buf + field.size();
+#endif
+}
+
+bool DecodeCsvPosReport(std::string_view payload, PosReport &report) {
+    std::string_view field;
+    Interpolator::EntityState &s = report.state;
+    return NextField(payload, field) && ParseField(field, s.timestamp) &&
+           NextField(payload, report.clientId) && !report.clientId.empty() &&
+           NextField(payload, field) && ParseField(field, s.lat) &&
+           NextField(payload, field) && ParseField(field, s.lon) &&
+           NextField(payload, field) && ParseField(field, s.el) &&
+           NextField(payload, field) && ParseField(field, s.pitch) &&
+           NextField(payload, field) && ParseField(field, s.roll) &&
+           NextField(payload, field) && ParseField(field, s.heading);
+}
+
+/// Appends `val` with `precision` fixed decimals and a `sep` to `out`
+static bool AppendField(char *&out, char *end, double val, int precision,
+                        char sep) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto res = std::to_chars(out, end, val, std::chars_format::fixed, precision);
+    if (res.ec != std::errc() || res.ptr == end)
+        return false;
+    out = res.ptr;
+#else
+    // No floating point to_chars in this standard library (e.g. older libc++)
+    const int len = std::snprintf(out, size_t(end - out), "%.*f", precision, val);
+    if (len < 0 || len >= end - out)
+        return false;
+    out += len;
+#endif
+    if (sep)
+        *out++ = sep;
+    return true;
+}
+
+size_t EncodeCsvPosReport(const Interpolator::EntityState &state, char *buf,
+                          size_t bufSize) {
+    char *out = buf;
+    char *end = buf + bufSize;
+    const bool ok = AppendField(out, end, state.lat, 8, ',') &&
+                    AppendField(out, end, state.lon, 8, ',') &&
+                    AppendField(out, end, state.el, 3, ',') &&
+                    AppendField(out, end, state.pitch, 3, ',') &&
+                    AppendField(out, end, state.roll, 3, ',') &&
+                    AppendField(out, end, state.heading, 3, 0);
+    return ok ? size_t(out - buf) : 0;
+}
+
+bool DecodeBinaryFrame(std::string_view payload, BinaryFrame &frame) {
+    ByteReader in(payload);
+    if (in.u8() != PROTO_VERSION)
+        return false;
+    frame.type = FrameType(in.u8());
+    frame.timestamp = int64_t(in.u64());
+    frame.clientId = in.str(in.u8());
+    // Only snapshots and clock sync replies come from the server itself and
+    // have no client ID
+    const bool fromServer =
+        frame.type == FRAME_SNAPSHOT || frame.type == FRAME_TIME;
+    if (!in.ok || frame.clientId.empty() != fromServer)
+        return false;
+    frame.body = std::string_view(reinterpret_cast<const char *>(in.p),
+                                  size_t(in.end - in.p));
+    return true;
+}
+
+SnapshotReader::SnapshotReader(const BinaryFrame &snapshot)
+    : m_timestamp(snapshot.timestamp), m_rest(snapshot.body) {
+    ByteReader in(m_rest);
+    m_remaining = in.u16();
+    if (in.ok)
+        m_rest.remove_prefix(2);
+}
+
+bool SnapshotReader::Next(BinaryFrame &record) {
+    if (m_remaining == 0)
+        return false;
+    ByteReader in(m_rest);
+    record.type = FrameType(in.u8());
+    record.timestamp = m_timestamp;
+    record.clientId = in.str(in.u8());
+    record.body = in.str(in.u16());
+    if (!in.ok || record.clientId.empty() || record.type == FRAME_SNAPSHOT) {
+        m_remaining = 0; // malformed, skip the rest
+        return false;
+    }
+    m_rest.remove_prefix(size_t(in.p - reinterpret_cast<const uint8_t *>(
+                                           m_rest.data())));
+    --m_remaining;
+    return true;
+}
+
+bool DecodeBinaryPosBody(std::string_view body,
+                         Interpolator::EntityState &state) {
+    ByteReader in(body);
+    state.lat = in.f64();
+    state.lon = in.f64();
+    state.el = in.f64();
+    state.pitch = in.f32();
+    state.roll = in.f32();
+    state.heading = in.f32();
+    return in.ok;
+}
+
+size_t EncodeBinaryPosReport(const Interpolator::EntityState &state,
+                             uint8_t *buf, size_t bufSize) {
+    ByteWriter out{buf, buf + bufSize};
+    if (!out.fits(BIN_POS_UP_SIZE))
+        return 0;
+    out.u8(PROTO_VERSION);
+    out.u8(FRAME_POS);
+    out.f64(state.lat);
+    out.f64(state.lon);
+    out.f64(state.el);
+    out.f32(float(state.pitch));
+    out.f32(float(state.roll));
+    out.f32(float(state.heading));
+    return size_t(out.p - buf);
+}
+
+size_t EncodeTimeRequest(int64_t t0, uint8_t *buf, size_t bufSize) {
+    ByteWriter out{buf, buf + bufSize};
+    if (!out.fits(BIN_TIME_UP_SIZE))
+        return 0;
+    out.u8(PROTO_VERSION);
+    out.u8(FRAME_TIME);
+    out.u64(uint64_t(t0));
+    return size_t(out.p - buf);
+}
+
+bool DecodeTimeReplyBody(std::string_view body, int64_t &t0, int64_t &t1) {
+    ByteReader in(body);
+    t0 = int64_t(in.u64());
+    t1 = int64_t(in.u64());
+    return in.ok;
+}
+
+uint8_t AircraftConfig::ToRatio(float ratio) {
+    return uint8_t(std::lround(std::clamp(ratio, 0.0f, 1.0f) * 255.0f));
+}
+
+size_t EncodeConfig(const AircraftConfig &config, uint8_t *buf,
+                    size_t bufSize) {
+    ByteWriter out{buf, buf + bufSize};
+    if (!out.fits(BIN_CONFIG_UP_SIZE))
+        return 0;
+    out.u8(PROTO_VERSION);
+    out.u8(FRAME_CONFIG);
+    out.u8(config.gear);
+    out.u8(config.flaps);
+    out.u8(config.speedbrake);
+    out.u8(config.thrust);
+    out.u16(config.lights);
+    return size_t(out.p - buf);
+}
+
+bool DecodeConfigBody(std::string_view body, AircraftConfig &config) {
+    ByteReader in(body);
+    config.gear = in.u8();
+    config.flaps = in.u8();
+    config.speedbrake = in.u8();
+    config.thrust = in.u8();
+    config.lights = in.u16();
+    return in.ok;
+}
+
+size_t EncodeSubscription(const Subscription &sub, uint8_t *buf,
+                          size_t bufSize) {
+    ByteWriter out{buf, buf + bufSize};
+    if (!out.fits(BIN_SUBSCRIBE_UP_SIZE))
+        return 0;
+    out.u8(PROTO_VERSION);
+    out.u8(FRAME_SUBSCRIBE);
+    out.f64(sub.lat);
+    out.f64(sub.lon);
+    out.f32(sub.radiusM);
+    out.f32(sub.nearM);
+    out.f32(sub.midM);
+    for (uint16_t interval : sub.intervalMs)
+        out.u16(interval);
+    return size_t(out.p - buf);
+}
+
+bool DecodeSubscriptionBody(std::string_view body, Subscription &sub) {
+    ByteReader in(body);
+    sub.lat = in.f64();
+    sub.lon = in.f64();
+    sub.radiusM = in.f32();
+    sub.nearM = in.f32();
+    sub.midM = in.f32();
+    for (uint16_t &interval : sub.intervalMs)
+        interval = in.u16();
+    return in.ok;
+}
+
+//------------------------------------------------------------------------------
+// Quantized key/delta frames
+//------------------------------------------------------------------------------
+
+/// Wraps a difference of angles given in `unitsPerTurn` to half a turn
+static int64_t WrapDelta(int64_t d, int64_t unitsPerTurn) {
+    d %= unitsPerTurn;
+    if (d >= unitsPerTurn / 2)
+        d -= unitsPerTurn;
+    else if (d < -unitsPerTurn / 2)
+        d += unitsPerTurn;
+    return d;
+}
+
+QuantizedState QuantizedState::From(const Interpolator::EntityState &state) {
+    QuantizedState q;
+    q.lat = int32_t(std::lround(state.lat * 1e7));
+    q.lon = int32_t(WrapDelta(std::llround(state.lon * 1e7), 3600000000LL));
+    q.el = int32_t(std::lround(state.el * 100.0));
+    q.pitch = int16_t(std::lround(state.pitch * 100.0));
+    q.roll = int16_t(WrapDelta(std::lround(state.roll * 100.0), 36000));
+    q.heading = int16_t(WrapDelta(std::lround(state.heading * 100.0), 36000));
+    return q;
+}
+
+void QuantizedState::To(Interpolator::EntityState &state) const {
+    state.lat = lat * 1e-7;
+    state.lon = lon * 1e-7;
+    state.el = el * 0.01;
+    state.pitch = pitch * 0.01;
+    state.roll = roll * 0.01;
+    // Hand out heading as 0..360 like X-Plane's true_psi
+    state.heading = heading < 0 ? heading * 0.01 + 360.0 : heading * 0.01;
+}
+
+size_t DeltaEncoder::Encode(const Interpolator::EntityState &state,
+                            uint8_t *buf, size_t bufSize) {
+    ByteWriter out{buf, buf + bufSize};
+    if (!out.fits(BIN_DELTA_UP_MAX_SIZE))
+        return 0;
+    const QuantizedState q = QuantizedState::From(state);
+    out.u8(PROTO_VERSION);
+
+    const bool keyDue =
+        m_keyDue || state.timestamp - m_keyMs >= KEYFRAME_INTERVAL_MS;
+    if (!keyDue) {
+        out.u8(FRAME_DELTA);
+        out.u8(m_keySeq);
+        out.svarint(int64_t(q.lat) - m_key.lat);
+        out.svarint(WrapDelta(int64_t(q.lon) - m_key.lon, 3600000000LL));
+        out.svarint(int64_t(q.el) - m_key.el);
+        out.svarint(int64_t(q.pitch) - m_key.pitch);
+        out.svarint(WrapDelta(int64_t(q.roll) - m_key.roll, 36000));
+        out.svarint(WrapDelta(int64_t(q.heading) - m_key.heading, 36000));
+    }
+    // Keyframe if due, or if we moved so far from the last one that the
+    // delta got larger than a keyframe
+    if (keyDue || size_t(out.p - buf) >= BIN_KEY_UP_SIZE) {
+        m_keySeq = uint8_t(m_keySeq + 1);
+        out.p = buf + 1;
+        out.u8(FRAME_KEY);
+        out.u8(m_keySeq);
+        out.u32(uint32_t(q.lat));
+        out.u32(uint32_t(q.lon));
+        out.u32(uint32_t(q.el));
+        out.u16(uint16_t(q.pitch));
+        out.u16(uint16_t(q.roll));
+        out.u16(uint16_t(q.heading));
+        m_key = q;
+        m_keyMs = state.timestamp;
+        m_keyDue = false;
+    }
+    return size_t(out.p - buf);
+}
+
+bool DeltaDecoder::Decode(FrameType type, std::string_view body,
+                          Interpolator::EntityState &state) {
+    ByteReader in(body);
+    const uint8_t seq = in.u8();
+    QuantizedState q;
+    if (type == FRAME_KEY) {
+        q.lat = int32_t(in.u32());
+        q.lon = int32_t(in.u32());
+        q.el = int32_t(in.u32());
+        q.pitch = int16_t(in.u16());
+        q.roll = int16_t(in.u16());
+        q.heading = int16_t(in.u16());
+        if (!in.ok) {
+            return false;
+        }
+        m_key = q;
+        m_keySeq = seq;
+        m_synced = true;
+    } else if (type == FRAME_DELTA) {
+        // A delta is only usable on top of the keyframe it was taken against,
+        // any frames lost since then don't matter
+        if (!m_synced || seq != m_keySeq) {
+            return false;
+        }
+        q.lat = int32_t(m_key.lat + in.svarint());
+        q.lon = int32_t(WrapDelta(m_key.lon + in.svarint(), 3600000000LL));
+        q.el = int32_t(m_key.el + in.svarint());
+        q.pitch = int16_t(m_key.pitch + in.svarint());
+        q.roll = int16_t(WrapDelta(m_key.roll + in.svarint(), 36000));
+        q.heading = int16_t(WrapDelta(m_key.heading + in.svarint(), 36000));
+        if (!in.ok) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    q.To(state);
+    return true;
+}
@@ -0,0 +1,267 @@
+//
+//  protocol.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <string_view>
+
+#include "config.h"
+#include "interpolator.h"
+
+/// Version of the binary frame layout, first byte of every binary frame
+constexpr uint8_t PROTO_VERSION = 1;
+/// WebSocket subprotocol for quantized key/delta frames, offered first
+constexpr const char *SUBPROTO_DELTA = "fwm.delta.v1";
+/// WebSocket subprotocol for full-precision binary frames.
+/// If the server selects neither, both directions stay on CSV text.
+constexpr const char *SUBPROTO_BINARY = "fwm.bin.v1";
+
+/// Frame format negotiated for a connection
+enum FrameFormat {
+    FORMAT_CSV = 0, ///< comma-separated text
+    FORMAT_BINARY,  ///< `FRAME_POS` binary frames
+    FORMAT_DELTA,   ///< `FRAME_KEY`/`FRAME_DELTA` binary frames
+};
+
+/// Type of a binary frame, second byte of every binary frame
+enum FrameType : uint8_t {
+    FRAME_POS = 1,      ///< full-precision position report
+    FRAME_KEY = 2,      ///< quantized absolute position report
+    FRAME_DELTA = 3,    ///< quantized position report relative to a keyframe
+    FRAME_SNAPSHOT = 4, ///< server frame bundling records of many clients
+    FRAME_TIME = 5,     ///< clock sync request, echoed by the server
+    FRAME_CONFIG = 6,   ///< aircraft configuration, sent on change
+    FRAME_SUBSCRIBE = 7, ///< region and rates we want to receive
+    FRAME_LEAVE = 8,     ///< a client disconnected, server to client only
+};
+
+/// Binary position report, client to server:
+/// `u8 version, u8 type, f64 lat, lon, el, f32 pitch, roll, heading`,
+/// all little-endian
+constexpr size_t BIN_POS_UP_SIZE = 2 + 3 * 8 + 3 * 4;
+/// Quantized keyframe, client to server:
+/// `u8 version, u8 type, u8 seq, i32 lat, lon, el, i16 pitch, roll, heading`,
+/// `seq` counting the keyframes of the connection
+constexpr size_t BIN_KEY_UP_SIZE = 3 + 3 * 4 + 3 * 2;
+/// Quantized delta, client to server: `u8 version, u8 type, u8 seq`,
+/// then the 6 field deltas as zigzag varints of up to 10 bytes each.
+/// Deltas are relative to the keyframe with the same `seq`, not to the
+/// frame before them, so a lost delta costs just its own sample.
+constexpr size_t BIN_DELTA_UP_MAX_SIZE = 3 + 6 * 10;
+/// Text position report, client to server: `lat,lon,el,pitch,roll,heading`
+/// with lat/lon at 1e-8 deg, el at mm and attitude at 1e-3 deg.
+/// This size fits any plausible values, encoding fails for absurd ones.
+constexpr size_t CSV_POS_UP_MAX_SIZE = 6 * 32;
+/// Clock sync request, client to server: `u8 version, u8 type, i64 t0`,
+/// t0 being our local time of sending. The server answers only this client,
+/// in the usual downlink header with its time of replying as `ts`, an empty
+/// client ID and the body `i64 t0, i64 t1`, t1 being its time of receiving.
+/// Servers that don't know the type ignore it, our clock then stays seeded
+/// from report timestamps.
+constexpr size_t BIN_TIME_UP_SIZE = 2 + 8;
+/// Aircraft configuration, client to server:
+/// `u8 version, u8 type, u8 gear, flaps, speedbrake, thrust, u16 lights`,
+/// see `AircraftConfig`. Relayed like position reports.
+constexpr size_t BIN_CONFIG_UP_SIZE = 2 + 4 + 2;
+/// Interest region, client to server:
+/// `u8 version, u8 type, f64 lat, lon, f32 radius, nearDist, midDist,
+/// u16 nearInterval, midInterval, farInterval`, see `Subscription`.
+/// Replaces the previous subscription of the connection, which starts out
+/// receiving everything. Servers that don't know the type ignore it.
+/// Intervals apply to `FRAME_POS` and `FRAME_DELTA`. `FRAME_KEY` is never
+/// thinned, the deltas after it are relative to it.
+constexpr size_t BIN_SUBSCRIBE_UP_SIZE = 2 + 2 * 8 + 3 * 4 + 3 * 2;
+/// Largest frame the client sends
+constexpr size_t MAX_UP_FRAME_SIZE = CSV_POS_UP_MAX_SIZE;
+
+/// Send a keyframe at least every this long [ms]. The dead reckoning gate
+/// sends at irregular intervals, so frame counts say little about time.
+/// Half of `PEER_STALE_MS`, so a receiver that missed a keyframe, or just
+/// joined, shows us again well before it would hide us.
+constexpr int64_t KEYFRAME_INTERVAL_MS = int64_t(2000 * MAX_HEARTBEAT_S);
+
+/// One position report of a remote client, decoded from a server frame
+struct PosReport {
+    /// Client ID, points into the payload the report was decoded from
+    std::string_view clientId;
+    /// Decoded state, `timestamp` is the server time in ms
+    Interpolator::EntityState state;
+};
+
+/// A binary server frame, split up but with its body not yet decoded.
+/// The server relays the client's frame with its timestamp and the client ID
+/// inserted after the type:
+/// `u8 version, u8 type, i64 ts, u8 idLen, char id[idLen], <client body>`
+struct BinaryFrame {
+    FrameType type;
+    int64_t timestamp;          ///< server time in ms
+    std::string_view clientId;  ///< points into the payload
+    std::string_view body;      ///< what the client sent after the type byte
+};
+
+/// Walks the records of a `FRAME_SNAPSHOT` frame, which the server sends to
+/// deliver the reports of many clients at one server tick in one message.
+/// Its header has an empty client ID, its body is
+/// `u16 count, count * (u8 type, u8 idLen, char id[idLen], u16 len, u8 body[len])`
+class SnapshotReader {
+  public:
+    explicit SnapshotReader(const BinaryFrame &snapshot);
+    /// Returns the next record as if it had been sent in a frame of its own
+    /// @return `false` after the last record or if the frame is malformed
+    bool Next(BinaryFrame &record);
+
+  private:
+    int64_t m_timestamp;
+    std::string_view m_rest;
+    uint16_t m_remaining = 0;
+};
+
+/// Decodes a text frame `ts,clientId,lat,lon,el,pitch,roll,heading` in place.
+/// Does not allocate; `report.clientId` is only valid as long as `payload` is.
+/// @return `false` if the frame is malformed, `report` is undefined then
+bool DecodeCsvPosReport(std::string_view payload, PosReport &report);
+
+/// Splits a binary server frame into header fields and body
+/// @return `false` if the frame is malformed or of another version
+bool DecodeBinaryFrame(std::string_view payload, BinaryFrame &frame);
+
+/// Decodes the body of a `FRAME_POS` frame (`timestamp` is left untouched)
+bool DecodeBinaryPosBody(std::string_view body,
+                         Interpolator::EntityState &state);
+
+/// Encodes our own state (`timestamp` is ignored) as text into `buf`,
+/// without allocating and without losing double precision
+/// @return Number of chars written (not zero-terminated), `0` if `bufSize` is
+///         too small
+size_t EncodeCsvPosReport(const Interpolator::EntityState &state, char *buf,
+                          size_t bufSize);
+
+/// Encodes our own state (`timestamp` is ignored) into `buf`
+/// @return Number of bytes written, `0` if `bufSize` is too small
+size_t EncodeBinaryPosReport(const Interpolator::EntityState &state,
+                             uint8_t *buf, size_t bufSize);
+
+/// Encodes a clock sync request sent at our local time `t0` into `buf`
+/// @return Number of bytes written, `0` if `bufSize` is too small
+size_t EncodeTimeRequest(int64_t t0, uint8_t *buf, size_t bufSize);
+
+/// Decodes the body of a `FRAME_TIME` reply
+bool DecodeTimeReplyBody(std::string_view body, int64_t &t0, int64_t &t1);
+
+/// Bits of `AircraftConfig::lights`
+enum LightBits : uint16_t {
+    LIGHT_TAXI = 1 << 0,
+    LIGHT_LANDING = 1 << 1,
+    LIGHT_BEACON = 1 << 2,
+    LIGHT_STROBE = 1 << 3,
+    LIGHT_NAV = 1 << 4,
+};
+
+/// Configuration of an aircraft, which changes far less often than its
+/// position. Ratios are quantized to 1/255, so sensor noise below that
+/// doesn't count as a change.
+struct AircraftConfig {
+    uint8_t gear = 255;    ///< gear deploy ratio, down until told otherwise
+    uint8_t flaps = 0;     ///< flap deploy ratio
+    uint8_t speedbrake = 0;
+    uint8_t thrust = 0;    ///< throttle ratio
+    uint16_t lights = LIGHT_BEACON | LIGHT_NAV; ///< `LightBits`
+
+    static uint8_t ToRatio(float ratio);
+    static float FromRatio(uint8_t ratio) { return ratio / 255.0f; }
+
+    bool operator==(const AircraftConfig &o) const {
+        return gear == o.gear && flaps == o.flaps &&
+               speedbrake == o.speedbrake && thrust == o.thrust &&
+               lights == o.lights;
+    }
+    bool operator!=(const AircraftConfig &o) const { return !(*this == o); }
+};
+
+/// Encodes our own configuration into `buf`
+/// @return Number of bytes written, `0` if `bufSize` is too small
+size_t EncodeConfig(const AircraftConfig &config, uint8_t *buf,
+                    size_t bufSize);
+
+/// Decodes the body of a `FRAME_CONFIG` frame
+bool DecodeConfigBody(std::string_view body, AircraftConfig &config);
+
+/// Which remote clients we want to receive, and how often
+struct Subscription {
+    double lat = 0.0;     ///< center of the region [deg]
+    double lon = 0.0;     ///< center of the region [deg]
+    float radiusM = 0.0f; ///< drop clients farther away than this [m]
+    /// Clients within `nearM` of the center are wanted at
+    /// `intervalMs[0]`, within `midM` at `intervalMs[1]`, beyond at
+    /// `intervalMs[2]`, 0 meaning every report [m]
+    float nearM = 0.0f;
+    float midM = 0.0f;
+    uint16_t intervalMs[3] = {0, 0, 0};
+};
+
+/// Encodes our interest region into `buf`
+/// @return Number of bytes written, `0` if `bufSize` is too small
+size_t EncodeSubscription(const Subscription &sub, uint8_t *buf,
+                          size_t bufSize);
+
+/// Decodes the body of a `FRAME_SUBSCRIBE` frame, what a server does
+bool DecodeSubscriptionBody(std::string_view body, Subscription &sub);
+
+/// A state quantized for the key/delta frames
+struct QuantizedState {
+    int32_t lat = 0;     ///< [1e-7 deg]
+    int32_t lon = 0;     ///< [1e-7 deg], -180..180
+    int32_t el = 0;      ///< [cm]
+    int16_t pitch = 0;   ///< [0.01 deg]
+    int16_t roll = 0;    ///< [0.01 deg]
+    int16_t heading = 0; ///< [0.01 deg], -180..180
+
+    static QuantizedState From(const Interpolator::EntityState &state);
+    void To(Interpolator::EntityState &state) const;
+};
+
+/// Sender side of the key/delta frames, one per connection.
+/// Deltas are taken against the _quantized_ state of the last keyframe, so
+/// rounding errors don't accumulate and lost deltas don't matter.
+class DeltaEncoder {
+  public:
+    /// Encodes the next frame into `buf`, a keyframe if due
+    /// @param state Own state, `timestamp` in local ms
+    /// @return Number of bytes written, `0` if `bufSize` is too small
+    size_t Encode(const Interpolator::EntityState &state, uint8_t *buf,
+                  size_t bufSize);
+    /// Next frame will be a keyframe, e.g. after a reconnect or when a
+    /// client joined that never got one of ours
+    void Reset() { m_keyDue = true; }
+
+  private:
+    QuantizedState m_key;
+    int64_t m_keyMs = 0;
+    uint8_t m_keySeq = 0;
+    bool m_keyDue = true;
+};
+
+/// Receiver side of the key/delta frames, one per remote client
+class DeltaDecoder {
+  public:
+    /// Decodes the body of a `FRAME_KEY` or `FRAME_DELTA` frame.
+    /// Deltas against a keyframe we never got are dropped until the next
+    /// keyframe resyncs the decoder.
+    /// @return `false` if nothing could be decoded, `state` is undefined then
+    bool Decode(FrameType type, std::string_view body,
+                Interpolator::EntityState &state);
+    /// Wait for the next keyframe, e.g. after a reconnect
+    void Reset() { m_synced = false; }
+
+  private:
+    QuantizedState m_key;
+    uint8_t m_keySeq = 0;
+    bool m_synced = false;
+};
+
+#endif // PROTOCOL_H
@@ -0,0 +1,112 @@
+//
+//  serverClock.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+
+#include "serverClock.h"
+#include "common.h"
+
+#include <algorithm>
+#include <chrono>
+
+/// Weight of a new offset sample
+constexpr double OFFSET_GAIN = 0.25;
+/// Weight of a new sample's error on the drift
+constexpr double DRIFT_GAIN = 0.05;
+/// Largest drift we believe in, 1000 ppm
+constexpr double MAX_DRIFT = 1e-3;
+/// Errors beyond this step the clock instead of steering it [ms]
+constexpr double STEP_THRESHOLD_MS = 1000.0;
+
+ServerClock *ServerClock::instance = nullptr;
+
+ServerClock *ServerClock::GetInstance() {
+    if (instance == nullptr) {
+        instance = new ServerClock();
+    }
+    return instance;
+}
+
+int64_t ServerClock::LocalNow() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+int64_t ServerClock::ToServer(int64_t localMs) const {
+    uint32_t seq;
+    int64_t base;
+    double offset, drift;
+    do {
+        seq = m_seq.load(std::memory_order_acquire);
+        base = m_base.load(std::memory_order_relaxed);
+        offset = m_offset.load(std::memory_order_relaxed);
+        drift = m_drift.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != m_seq.load(std::memory_order_relaxed));
+    return localMs + int64_t(offset + drift * double(localMs - base));
+}
+
+void ServerClock::publish(int64_t base, double offset, double drift) {
+    const uint32_t seq = m_seq.load(std::memory_order_relaxed);
+    m_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_base.store(base, std::memory_order_relaxed);
+    m_offset.store(offset, std::memory_order_relaxed);
+    m_drift.store(drift, std::memory_order_relaxed);
+    m_seq.store(seq + 2, std::memory_order_release);
+}
+
+void ServerClock::Seed(int64_t serverMs, int64_t localMs) {
+    if (m_seeded) {
+        return;
+    }
+    m_seeded = true;
+    publish(localMs, double(serverMs - localMs), 0.0);
+    LogMsg("Server clock seeded, offset(ms): %lld",
+           (long long)(serverMs - localMs));
+}
+
+void ServerClock::OnTimeReply(int64_t t0, int64_t t1, int64_t t2,
+                              int64_t t3) {
+    // Round trip minus the server's processing time
+    const int64_t delay = std::max<int64_t>(0, (t3 - t0) - (t2 - t1));
+    // Assumes both directions take equally long
+    const double sample = double((t1 - t0) + (t2 - t3)) / 2.0;
+
+    // Samples delayed by queueing are way off, skip those taking much
+    // longer than the best recent one
+    m_delays[m_numDelays++ % DELAY_WINDOW] = delay;
+    const int64_t minDelay =
+        *std::min_element(m_delays,
+                          m_delays + std::min(m_numDelays, DELAY_WINDOW));
+    if (delay > 2 * minDelay + 10) {
+        return;
+    }
+
+    const int64_t base = m_base.load(std::memory_order_relaxed);
+    const double offset = m_offset.load(std::memory_order_relaxed);
+    const double drift = m_drift.load(std::memory_order_relaxed);
+    const double elapsed = double(t3 - base);
+    const double predicted = offset + drift * elapsed;
+    const double error = sample - predicted;
+
+    if (m_numSamples == 0 || std::abs(error) > STEP_THRESHOLD_MS) {
+        // First sample, or the server clock jumped
+        publish(t3, sample, m_numSamples == 0 ? 0.0 : drift);
+        LogMsg("Server clock set, offset(ms): %.1f, round trip(ms): %lld",
+               sample, (long long)delay);
+    } else {
+        // Steer: a share of the error goes into the offset, a smaller one
+        // into the rate, so that persistent errors (drift) die out
+        const double newDrift =
+            elapsed > 0.0 ? std::clamp(drift + DRIFT_GAIN * error / elapsed,
+                                       -MAX_DRIFT, MAX_DRIFT)
+                          : drift;
+        publish(t3, predicted + OFFSET_GAIN * error, newDrift);
+    }
+    m_seeded = true;
+    ++m_numSamples;
+}
@@ -0,0 +1,63 @@
+//
+//  serverClock.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef SERVER_CLOCK_H
+#define SERVER_CLOCK_H
+
+#include <atomic>
+#include <cstdint>
+
+/// Our estimate of the server's clock, shared by all remote aircraft.
+/// Synchronized NTP-style by `FRAME_TIME` requests the server echoes:
+/// each exchange gives an offset sample, the samples with the least round
+/// trip delay steer a filtered offset and drift.
+/// The asio thread updates the estimate, any thread may read it.
+class ServerClock final {
+  public:
+    static ServerClock *GetInstance();
+
+    /// Local monotonic time [ms], immune to system clock adjustments
+    static int64_t LocalNow();
+    /// Server time at local time `localMs` [ms]
+    int64_t ToServer(int64_t localMs) const;
+    /// Server time now [ms]
+    int64_t Now() const { return ToServer(LocalNow()); }
+
+    /// asio thread: first guess from a server timestamp received at local
+    /// time `localMs`, ignoring the network delay. No-op once seeded.
+    void Seed(int64_t serverMs, int64_t localMs);
+    /// asio thread: a `FRAME_TIME` exchange, sent at local `t0`, received
+    /// by the server at `t1`, answered at `t2`, received back at local `t3`
+    void OnTimeReply(int64_t t0, int64_t t1, int64_t t2, int64_t t3);
+    /// asio thread: whether to ask for the next sample sooner than usual
+    bool IsConverging() const { return m_numSamples < FAST_SAMPLES; }
+
+  private:
+    ServerClock() = default;
+    static ServerClock *instance;
+
+    /// Round trip delays of the last exchanges kept to tell good ones
+    static constexpr uint32_t DELAY_WINDOW = 8;
+    /// Samples taken at a fast pace after start
+    static constexpr uint32_t FAST_SAMPLES = 8;
+
+    void publish(int64_t base, double offset, double drift);
+
+    // Estimate: server = local + offset + drift * (local - base),
+    // published as a seqlock
+    std::atomic<uint32_t> m_seq{0};
+    std::atomic<int64_t> m_base{0};
+    std::atomic<double> m_offset{0.0};
+    std::atomic<double> m_drift{0.0};
+
+    // Filter state, asio thread only
+    int64_t m_delays[DELAY_WINDOW];
+    uint32_t m_numDelays = 0;
+    uint32_t m_numSamples = 0;
+    bool m_seeded = false;
+};
+
+#endif // SERVER_CLOCK_H
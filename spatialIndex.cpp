@@ -0,0 +1,257 @@
+//
+//  spatialIndex.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+
+#include "spatialIndex.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cmath>
+
+static_assert((2 * MAX_PEERS & (2 * MAX_PEERS - 1)) == 0,
+              "hash capacity must be a power of two");
+
+SpatialIndex::SpatialIndex() = default;
+
+int32_t SpatialIndex::LatIndex(double lat) {
+    const int32_t i = int32_t(std::floor((lat + 90.0) / SPATIAL_CELL_DEG));
+    return std::clamp(i, 0, LAT_CELLS - 1);
+}
+
+int32_t SpatialIndex::LonIndex(double lon) {
+    const double l = std::remainder(lon, 360.0) + 180.0; // 0..360
+    const int32_t i = int32_t(std::floor(l / SPATIAL_CELL_DEG));
+    return std::clamp(i, 0, LON_CELLS - 1);
+}
+
+uint32_t SpatialIndex::findBucket(uint32_t cell) const {
+    uint32_t i = Home(cell);
+    // At most MAX_PEERS occupied buckets, so there always is an empty one
+    while (m_buckets[i].head != NONE && m_buckets[i].cell != cell) {
+        i = (i + 1) & (HASH_CAPACITY - 1);
+    }
+    return i;
+}
+
+void SpatialIndex::eraseBucket(uint32_t i) {
+    // Pull later buckets of the probe run into the hole, unless that would
+    // move them before their home bucket
+    for (uint32_t j = i;;) {
+        j = (j + 1) & (HASH_CAPACITY - 1);
+        if (m_buckets[j].head == NONE) {
+            break;
+        }
+        const uint32_t home = Home(m_buckets[j].cell);
+        if (((j - home) & (HASH_CAPACITY - 1)) <
+            ((j - i) & (HASH_CAPACITY - 1))) {
+            continue; // home is between the hole and j
+        }
+        m_buckets[i] = m_buckets[j];
+        i = j;
+    }
+    m_buckets[i] = Bucket();
+}
+
+void SpatialIndex::link(uint16_t slot, uint32_t cell) {
+    Bucket &bucket = m_buckets[findBucket(cell)];
+    Entry &entry = m_entries[slot];
+    bucket.cell = cell;
+    entry.cell = cell;
+    entry.prev = NONE;
+    entry.next = bucket.head;
+    if (bucket.head != NONE) {
+        m_entries[bucket.head].prev = slot;
+    }
+    bucket.head = slot;
+}
+
+void SpatialIndex::unlink(uint16_t slot) {
+    Entry &entry = m_entries[slot];
+    if (entry.next != NONE) {
+        m_entries[entry.next].prev = entry.prev;
+    }
+    if (entry.prev != NONE) {
+        m_entries[entry.prev].next = entry.next;
+    } else {
+        const uint32_t i = findBucket(entry.cell);
+        m_buckets[i].head = entry.next;
+        if (entry.next == NONE) {
+            eraseBucket(i); // cell is empty now
+        }
+    }
+    entry.cell = NO_CELL;
+    entry.prev = entry.next = NONE;
+}
+
+void SpatialIndex::Update(uint16_t slot, double lat, double lon) {
+    Entry &entry = m_entries[slot];
+    entry.lat = lat;
+    entry.lon = lon;
+    const uint32_t cell = Cell(LatIndex(lat), LonIndex(lon));
+    if (cell == entry.cell) {
+        return; // the common case, planes take minutes to cross a cell
+    }
+    if (entry.cell != NO_CELL) {
+        unlink(slot);
+    } else {
+        ++m_count;
+    }
+    link(slot, cell);
+}
+
+void SpatialIndex::Remove(uint16_t slot) {
+    if (m_entries[slot].cell == NO_CELL) {
+        return;
+    }
+    unlink(slot);
+    --m_count;
+}
+
+template <typename Visit>
+void SpatialIndex::forCell(int32_t latIdx, int32_t lonIdx,
+                           Visit &&visit) const {
+    const uint32_t cell = Cell(latIdx, lonIdx);
+    const Bucket &bucket = m_buckets[findBucket(cell)];
+    if (bucket.head == NONE) {
+        return;
+    }
+    for (uint16_t slot = bucket.head; slot != NONE;
+         slot = m_entries[slot].next) {
+        visit(slot);
+    }
+}
+
+size_t SpatialIndex::Radius(double lat, double lon, double radiusM,
+                            uint16_t *out, size_t maxCount,
+                            double *distM) const {
+    size_t found = 0;
+    auto visit = [&](uint16_t slot) {
+        const Entry &entry = m_entries[slot];
+        // North-south distance alone rejects most of the cells' corners
+        if (std::abs(entry.lat - lat) * M_PER_DEG_LAT > radiusM) {
+            return;
+        }
+        const double d = GroundDistanceM(lat, lon, entry.lat, entry.lon);
+        if (d <= radiusM) {
+            if (found < maxCount) {
+                out[found] = slot;
+                if (distM) {
+                    distM[found] = d;
+                }
+            }
+            ++found;
+        }
+    };
+
+    // Cells the circle can reach: east-west by the widest degree of
+    // longitude it spans, which is at its latitude farthest from the equator
+    const double dLat = radiusM / M_PER_DEG_LAT;
+    const double cosMax =
+        std::cos(deg2rad(std::min(90.0, std::abs(lat) + dLat)));
+    const double dLon =
+        cosMax > 1e-9 ? radiusM / (M_PER_DEG_LAT * cosMax) : 360.0;
+    const int32_t lonHalf = int32_t(
+        std::min(std::ceil(dLon / SPATIAL_CELL_DEG), double(LON_CELLS)));
+    const int32_t latLo = LatIndex(lat - dLat);
+    const int32_t latHi = LatIndex(lat + dLat);
+
+    // Looking up more cells than there are planes costs more than a scan
+    if (int64_t(latHi - latLo + 1) * (2 * lonHalf + 1) > m_count) {
+        for (uint16_t slot = 0; slot < MAX_PEERS; ++slot) {
+            if (m_entries[slot].cell != NO_CELL) {
+                visit(slot);
+            }
+        }
+        return found;
+    }
+    const int32_t lon0 = LonIndex(lon);
+    for (int32_t latIdx = latLo; latIdx <= latHi; ++latIdx) {
+        for (int32_t d = -lonHalf; d <= lonHalf; ++d) {
+            forCell(latIdx, (lon0 + d + LON_CELLS) % LON_CELLS, visit);
+        }
+    }
+    return found;
+}
+
+size_t SpatialIndex::Nearest(double lat, double lon, size_t k, uint16_t *out,
+                             double *distM) const {
+    k = std::min(k, SPATIAL_MAX_NEAREST);
+    if (k == 0 || m_count == 0) {
+        return 0;
+    }
+
+    // The k best so far, sorted by distance
+    uint16_t best[SPATIAL_MAX_NEAREST];
+    double bestDist[SPATIAL_MAX_NEAREST];
+    size_t found = 0;
+    uint16_t visited = 0;
+    auto visit = [&](uint16_t slot) {
+        ++visited;
+        const Entry &entry = m_entries[slot];
+        if (found == k &&
+            std::abs(entry.lat - lat) * M_PER_DEG_LAT >= bestDist[k - 1]) {
+            return; // farther north-south alone
+        }
+        const double d = GroundDistanceM(lat, lon, entry.lat, entry.lon);
+        if (found == k && d >= bestDist[k - 1]) {
+            return;
+        }
+        size_t i = found < k ? found++ : k - 1;
+        for (; i > 0 && bestDist[i - 1] > d; --i) {
+            best[i] = best[i - 1];
+            bestDist[i] = bestDist[i - 1];
+        }
+        best[i] = slot;
+        bestDist[i] = d;
+    };
+
+    // Search rings of cells around the query's cell, until everything
+    // outside the rings searched is farther than the k-th best
+    const int32_t lat0 = LatIndex(lat);
+    const int32_t lon0 = LonIndex(lon);
+    for (int32_t r = 0; visited < m_count; ++r) {
+        if ((2 * r + 1) * (2 * r + 1) > m_count / 4) {
+            // Sparse planes leave most cells empty, and a few hundred empty
+            // lookups cost as much as scanning all planes. Also keeps rings
+            // from wrapping around the globe.
+            found = 0;
+            for (uint16_t slot = 0; slot < MAX_PEERS; ++slot) {
+                if (m_entries[slot].cell != NO_CELL) {
+                    visit(slot);
+                }
+            }
+            break;
+        }
+        for (int32_t dLat = -r; dLat <= r; ++dLat) {
+            const int32_t latIdx = lat0 + dLat;
+            if (latIdx < 0 || latIdx >= LAT_CELLS) {
+                continue;
+            }
+            // Whole rows at the top and bottom, the two edge cells between
+            const int32_t step = (dLat == -r || dLat == r) ? 1 : 2 * r;
+            for (int32_t dLon = -r; dLon <= r; dLon += step) {
+                forCell(latIdx, (lon0 + dLon + LON_CELLS) % LON_CELLS, visit);
+            }
+        }
+        if (found == k) {
+            // Anything beyond ring r is more than r cells away in latitude
+            // or in longitude, the latter at most this far from the equator
+            const double maxLat = std::min(
+                90.0, std::abs(lat) + (r + 1) * SPATIAL_CELL_DEG);
+            const double boundM = r * SPATIAL_CELL_DEG * M_PER_DEG_LAT *
+                                  std::cos(deg2rad(maxLat));
+            if (bestDist[k - 1] <= boundM) {
+                break;
+            }
+        }
+    }
+
+    std::copy(best, best + found, out);
+    if (distM) {
+        std::copy(bestDist, bestDist + found, distM);
+    }
+    return found;
+}
@@ -0,0 +1,93 @@
+//
+//  spatialIndex.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "peerRegistry.h"
+
+/// Grid cell size [deg], about 28 km north-south
+constexpr double SPATIAL_CELL_DEG = 0.25;
+/// Most planes `SpatialIndex::Nearest` returns
+constexpr size_t SPATIAL_MAX_NEAREST = 32;
+
+/// Remote planes by position, for proximity queries that don't scan all of
+/// them. Slots are bucketed into a uniform lat/lon grid; only occupied cells
+/// are stored, in a flat open-addressing hash with each cell's slots in an
+/// intrusive list. Moving a plane within its cell is a plain store, moving
+/// it to another cell relinks it. Nothing allocates. Sim thread only.
+class SpatialIndex {
+  public:
+    SpatialIndex();
+
+    /// Moves `slot` to the given position, adding it if it isn't indexed
+    void Update(uint16_t slot, double lat, double lon);
+    /// Takes `slot` out of the index, if it is in it
+    void Remove(uint16_t slot);
+    /// Whether `slot` is indexed
+    bool Contains(uint16_t slot) const {
+        return m_entries[slot].cell != NO_CELL;
+    }
+    /// Number of indexed slots
+    uint16_t Count() const { return m_count; }
+
+    /// Slots within `radiusM` of the position, in no particular order, with
+    /// their distances [m] in `distM` if not `nullptr`
+    /// @return Number of slots found, only the first `maxCount` are written
+    size_t Radius(double lat, double lon, double radiusM, uint16_t *out,
+                  size_t maxCount, double *distM = nullptr) const;
+    /// The `k` slots nearest to the position, nearest first, with their
+    /// distances [m] in `distM` if not `nullptr`.
+    /// `k` is capped at `SPATIAL_MAX_NEAREST`.
+    /// @return Number of slots written, less than `k` if fewer are indexed
+    size_t Nearest(double lat, double lon, size_t k, uint16_t *out,
+                   double *distM = nullptr) const;
+
+  private:
+    static constexpr int32_t LAT_CELLS = int32_t(180.0 / SPATIAL_CELL_DEG);
+    static constexpr int32_t LON_CELLS = int32_t(360.0 / SPATIAL_CELL_DEG);
+    // At most one occupied cell per slot, twice that keeps probing short
+    static constexpr uint32_t HASH_CAPACITY = 2 * MAX_PEERS;
+    static constexpr uint16_t NONE = UINT16_MAX;
+    static constexpr uint32_t NO_CELL = UINT32_MAX;
+
+    struct Bucket {
+        uint32_t cell = NO_CELL;
+        uint16_t head = NONE; ///< first slot in the cell
+    };
+    struct Entry {
+        double lat, lon;
+        uint32_t cell = NO_CELL; ///< `NO_CELL` if not indexed
+        uint16_t prev = NONE, next = NONE;
+    };
+
+    static int32_t LatIndex(double lat);
+    static int32_t LonIndex(double lon);
+    static uint32_t Cell(int32_t latIdx, int32_t lonIdx) {
+        return uint32_t(latIdx) * LON_CELLS + uint32_t(lonIdx);
+    }
+    static uint32_t Home(uint32_t cell) {
+        return ((cell * 2654435761u) >> 8) & (HASH_CAPACITY - 1);
+    }
+    /// Bucket of `cell`, or the empty bucket it would go to
+    uint32_t findBucket(uint32_t cell) const;
+    /// Empties bucket `i`, keeping the probe runs behind it intact
+    void eraseBucket(uint32_t i);
+    void link(uint16_t slot, uint32_t cell);
+    void unlink(uint16_t slot);
+    /// Calls `visit(slot)` for each slot in the given cell
+    template <typename Visit>
+    void forCell(int32_t latIdx, int32_t lonIdx, Visit &&visit) const;
+
+    Entry m_entries[MAX_PEERS];
+    Bucket m_buckets[HASH_CAPACITY];
+    uint16_t m_count = 0;
+};
+
+#endif // SPATIAL_INDEX_H
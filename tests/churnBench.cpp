@@ -0,0 +1,134 @@
+//
+//  churnBench.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+// 1000 clients joining and leaving over and over, as in a busy event: what
+// a join and a leave cost the asio and the sim thread, that the registry
+// recycles its slots for new clients, and that nothing allocates once it
+// has seen them all. Both threads' parts run in turn on one thread. The
+// XPMP2 aircraft in `AppState`'s plane slab need X-Plane and are left out.
+
+#include "peerRegistry.h"
+#include "testUtil.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+constexpr int CLIENTS = 1000;
+/// Reports each client sends between joining and leaving
+constexpr int REPORTS = 4;
+/// Each round's clients get IDs of their own, after this many rounds the
+/// first round's IDs come back
+constexpr int ID_SETS = 4;
+
+struct Costs {
+    int64_t join = 0, ingest = 0, leave = 0, release = 0; // [ns]
+};
+
+/// One round: all clients join and report, the sim thread takes the
+/// reports, all clients leave, the sim thread tears their slots down
+static void Round(PeerRegistry &peers, const std::vector<std::string> &ids,
+                  const std::vector<Interpolator::EntityState> &reports,
+                  int round, Costs &costs) {
+    const std::string *id = &ids[size_t(round % ID_SETS) * CLIENTS];
+
+    // asio thread: `AppState::findOrAddPeer` and the reports
+    int64_t start = NowNs();
+    for (int c = 0; c < CLIENTS; ++c) {
+        NetworkAircraft *peer = peers.Find(id[c]);
+        EXPECT(!peer);
+        peer = peers.Add(id[c]);
+        if (!peer) {
+            EXPECT(peer);
+            return;
+        }
+        peers.Publish(*peer);
+        for (int tick = 0; tick < REPORTS; ++tick) {
+            const Interpolator::EntityState &s = reports[c * REPORTS + tick];
+            peer->inbound.Push({s, s.timestamp + 100});
+        }
+    }
+    costs.join += NowNs() - start;
+
+    // Sim thread: `AppState::InboundLoopCallback` taking the reports
+    start = NowNs();
+    InboundState in;
+    int ingested = 0;
+    for (uint16_t slot = 0; slot < peers.Count(); ++slot) {
+        NetworkAircraft &peer = peers[slot];
+        if (peer.state.load(std::memory_order_acquire) != SLOT_ACTIVE) {
+            continue;
+        }
+        while (peer.inbound.Pop(in)) {
+            peer.interpolator.OnPosReport(in.state, in.arrivalMs);
+            peer.lastReportMs = in.arrivalMs;
+            ++ingested;
+        }
+    }
+    costs.ingest += NowNs() - start;
+    EXPECT(ingested == CLIENTS * REPORTS);
+
+    // asio thread: `AppState::removePeer` on FRAME_LEAVE
+    start = NowNs();
+    for (int c = 0; c < CLIENTS; ++c) {
+        NetworkAircraft *peer = peers.Find(id[c]);
+        EXPECT(peer);
+        if (peer) {
+            peers.Remove(*peer);
+        }
+    }
+    costs.leave += NowNs() - start;
+
+    // Sim thread: `AppState::releasePeer`
+    start = NowNs();
+    for (uint16_t slot = 0; slot < peers.Count(); ++slot) {
+        NetworkAircraft &peer = peers[slot];
+        if (peer.state.load(std::memory_order_acquire) == SLOT_LEAVING) {
+            peers.Release(slot);
+        }
+    }
+    costs.release += NowNs() - start;
+}
+
+int main(int argc, char **argv) {
+    const int rounds = QuickRun(argc, argv) ? 20 : 1000;
+    // Longer than std::string keeps inline, as IDs from auth keys can be
+    std::vector<std::string> ids;
+    for (int i = 0; i < ID_SETS * CLIENTS; ++i) {
+        ids.push_back("event-guest-" + SyntheticId(i));
+    }
+    std::vector<Interpolator::EntityState> reports;
+    for (int c = 0; c < CLIENTS; ++c) {
+        for (int tick = 0; tick < REPORTS; ++tick) {
+            reports.push_back(SyntheticState(c, tick));
+        }
+    }
+
+    static PeerRegistry peers; // too large for the stack
+    Costs costs;
+    // Once with each set of IDs, copying them into the slots may allocate
+    for (int round = 0; round < ID_SETS; ++round) {
+        Round(peers, ids, reports, round, costs);
+    }
+
+    costs = Costs();
+    const size_t allocs = AllocCount();
+    for (int round = 0; round < rounds; ++round) {
+        Round(peers, ids, reports, round, costs);
+    }
+    EXPECT(AllocCount() == allocs);
+    // Every join took a slot a leave handed back
+    EXPECT(peers.Count() == CLIENTS);
+
+    const double joins = double(rounds) * CLIENTS;
+    std::printf("%d clients, %d rounds, %zu allocations\n", CLIENTS, rounds,
+                AllocCount() - allocs);
+    std::printf("  join    %6.1f ns asio, %6.1f ns sim for %d reports\n",
+                costs.join / joins, costs.ingest / joins, REPORTS);
+    std::printf("  leave   %6.1f ns asio, %6.1f ns sim\n",
+                costs.leave / joins, costs.release / joins);
+    return gFailures;
+}
@@ -0,0 +1,104 @@
+//
+//  clockSyncTest.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+// ServerClock against a simulated server whose clock is 5 s ahead and runs
+// 200 ppm fast, over a network with jittery delays and queueing spikes.
+// Requests and replies go through the real frame encoding and decoding.
+
+#include "protocol.h"
+#include "serverClock.h"
+#include "testUtil.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+/// Local time the simulation starts at [ms]
+constexpr double START_MS = 1.7e12;
+constexpr double SERVER_OFFSET_MS = 5000.0;
+constexpr double SERVER_SKEW = 200e-6;
+/// Sync intervals as AppState uses them, fast while converging [ms]
+constexpr double SYNC_FAST_MS = 200.0;
+constexpr double SYNC_MS = 2000.0;
+/// Error allowed once converged, a fraction of a 20 Hz report interval [ms]
+constexpr double MAX_ERROR_MS = 25.0;
+
+/// The simulated server's clock, stepped by `step` [ms]
+static double ServerTime(double localMs, double step) {
+    return START_MS + SERVER_OFFSET_MS + step +
+           (localMs - START_MS) * (1.0 + SERVER_SKEW);
+}
+
+int main() {
+    std::mt19937 rng(16);
+    std::uniform_real_distribution<double> jitter(10.0, 40.0);
+    std::bernoulli_distribution spike(0.1);
+    auto oneWay = [&] { return jitter(rng) + (spike(rng) ? 300.0 : 0.0); };
+
+    ServerClock *clock = ServerClock::GetInstance();
+    double local = START_MS;
+    double step = 0.0;
+
+    // Seeded from a report's timestamp, off by its one-way delay
+    const double delay = oneWay();
+    clock->Seed(int64_t(ServerTime(local, step)), int64_t(local + delay));
+    EXPECT(std::abs(clock->ToServer(int64_t(local + delay)) -
+                    ServerTime(local + delay, step)) <= delay + 1.0);
+
+    double maxError = 0.0, maxErrorAfterStep = 0.0;
+    int exchanges = 0;
+    while (local < START_MS + 40 * 60 * 1000.0) {
+        // Client: request at t0
+        uint8_t request[BIN_TIME_UP_SIZE];
+        const int64_t t0 = int64_t(local);
+        EXPECT(EncodeTimeRequest(t0, request, sizeof(request)) ==
+               BIN_TIME_UP_SIZE);
+
+        // Server: receives at t1, echoes t0 and t1 at t2
+        const double up = oneWay();
+        const int64_t t1 = int64_t(ServerTime(local + up, step));
+        const int64_t t2 = t1 + 1;
+        std::string reply =
+            RelayBinary({reinterpret_cast<char *>(request), sizeof(request)},
+                        t2, "");
+        for (int i = 0; i < 8; ++i) {
+            reply += char(uint64_t(t1) >> (8 * i));
+        }
+
+        // Client: receives at t3
+        const double t3 = local + up + 1.0 + oneWay();
+        BinaryFrame frame;
+        int64_t echoedT0 = 0, echoedT1 = 0;
+        EXPECT(DecodeBinaryFrame(reply, frame) && frame.type == FRAME_TIME);
+        EXPECT(DecodeTimeReplyBody(frame.body, echoedT0, echoedT1));
+        EXPECT(echoedT0 == t0 && echoedT1 == t1);
+        clock->OnTimeReply(echoedT0, echoedT1, frame.timestamp, int64_t(t3));
+        ++exchanges;
+
+        // How far off renderers are until the next exchange
+        local = t3 + (clock->IsConverging() ? SYNC_FAST_MS : SYNC_MS);
+        const double error =
+            std::abs(clock->ToServer(int64_t(local)) - ServerTime(local, step));
+        const double elapsed = local - START_MS;
+        if (elapsed > 5 * 60 * 1000.0 && step == 0.0) {
+            maxError = std::max(maxError, error);
+        }
+        if (elapsed > 21 * 60 * 1000.0) {
+            maxErrorAfterStep = std::max(maxErrorAfterStep, error);
+        }
+        // The server's clock jumps, e.g. set by its admin
+        if (elapsed > 20 * 60 * 1000.0 && step == 0.0) {
+            step = 3000.0;
+        }
+    }
+
+    std::printf("%d exchanges, max error %.2f ms converged, %.2f ms after "
+                "the server's clock stepped\n",
+                exchanges, maxError, maxErrorAfterStep);
+    EXPECT(maxError < MAX_ERROR_MS);
+    EXPECT(maxErrorAfterStep < MAX_ERROR_MS);
+    return gFailures;
+}
@@ -0,0 +1,158 @@
+//
+//  decodeBench.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+// What decoding inbound frames costs the asio thread, per format, for 100
+// clients at 20 Hz, and that it doesn't allocate
+
+#include "protocol.h"
+#include "testUtil.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+constexpr int CLIENTS = 100;
+constexpr int TICKS = 200; // 10 s
+
+/// Whether a decoded state is the sent one, up to the key/delta quantization
+static bool Matches(const Interpolator::EntityState &got,
+                    const Interpolator::EntityState &sent) {
+    return std::abs(got.lat - sent.lat) < 1e-7 &&
+           std::abs(got.lon - sent.lon) < 1e-7 &&
+           std::abs(got.el - sent.el) < 0.01 &&
+           std::abs(std::remainder(got.heading - sent.heading, 360.0)) <
+               0.01 &&
+           std::abs(got.pitch - sent.pitch) < 0.01 &&
+           std::abs(got.roll - sent.roll) < 0.01;
+}
+
+/// Decodes all `frames` with `decode(frame, index, verify)`, which returns
+/// whether the frame decoded, once checking the results, then `rounds` times
+/// more for the cost per report
+template <typename Decode>
+static void Run(const char *name, const std::vector<std::string> &frames,
+                int reportsPerFrame, int rounds, Decode &&decode) {
+    size_t bytes = 0, decoded = 0;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        bytes += frames[i].size();
+        decoded += decode(frames[i], i, true);
+    }
+    EXPECT(decoded == frames.size());
+
+    const size_t allocs = AllocCount();
+    const int64_t start = NowNs();
+    decoded = 0;
+    for (int round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < frames.size(); ++i) {
+            decoded += decode(frames[i], i, false);
+        }
+    }
+    const int64_t ns = NowNs() - start;
+    const size_t reports = frames.size() * size_t(reportsPerFrame * rounds);
+    EXPECT(decoded == frames.size() * rounds);
+    EXPECT(AllocCount() == allocs);
+    std::printf("%-10s %7.1f ns/report %6.1f bytes/report %zu allocations\n",
+                name, double(ns) / double(reports),
+                double(bytes) / double(frames.size() * reportsPerFrame),
+                AllocCount() - allocs);
+}
+
+int main(int argc, char **argv) {
+    const int rounds = QuickRun(argc, argv) ? 1 : 50;
+
+    // What the server relays in each format, tick by tick
+    std::vector<Interpolator::EntityState> sent;
+    std::vector<std::string> csv, pos, delta, snapshots;
+    std::vector<DeltaEncoder> encoders(CLIENTS);
+    std::vector<std::string> ids;
+    for (int c = 0; c < CLIENTS; ++c) {
+        ids.push_back(SyntheticId(c));
+    }
+    for (int t = 0; t < TICKS; ++t) {
+        std::vector<std::string> tickDelta;
+        for (int c = 0; c < CLIENTS; ++c) {
+            const Interpolator::EntityState s = SyntheticState(c, t);
+            sent.push_back(s);
+            char text[CSV_POS_UP_MAX_SIZE];
+            uint8_t buf[MAX_UP_FRAME_SIZE];
+            const size_t textLen = EncodeCsvPosReport(s, text, sizeof(text));
+            csv.push_back(RelayCsv({text, textLen}, s.timestamp, ids[c]));
+            const size_t posLen = EncodeBinaryPosReport(s, buf, sizeof(buf));
+            pos.push_back(RelayBinary(
+                {reinterpret_cast<char *>(buf), posLen}, s.timestamp, ids[c]));
+            const size_t deltaLen = encoders[c].Encode(s, buf, sizeof(buf));
+            tickDelta.push_back(
+                RelayBinary({reinterpret_cast<char *>(buf), deltaLen},
+                            s.timestamp, ids[c]));
+        }
+        std::vector<BinaryFrame> records(CLIENTS);
+        for (int c = 0; c < CLIENTS; ++c) {
+            DecodeBinaryFrame(tickDelta[c], records[c]);
+        }
+        snapshots.push_back(SnapshotFrame(sent.back().timestamp, records));
+        for (std::string &frame : tickDelta) {
+            delta.push_back(std::move(frame));
+        }
+    }
+
+    std::vector<DeltaDecoder> decoders(CLIENTS);
+    auto check = [&](bool verify, size_t report,
+                     const Interpolator::EntityState &got) {
+        if (verify) {
+            EXPECT(Matches(got, sent[report]));
+        }
+    };
+
+    Run("csv", csv, 1, rounds,
+        [&](const std::string &frame, size_t i, bool verify) {
+            PosReport report;
+            if (!DecodeCsvPosReport(frame, report))
+                return false;
+            check(verify, i, report.state);
+            return true;
+        });
+    Run("binary", pos, 1, rounds,
+        [&](const std::string &frame, size_t i, bool verify) {
+            BinaryFrame bin;
+            Interpolator::EntityState state;
+            if (!DecodeBinaryFrame(frame, bin) || bin.type != FRAME_POS ||
+                !DecodeBinaryPosBody(bin.body, state))
+                return false;
+            check(verify, i, state);
+            return true;
+        });
+    Run("delta", delta, 1, rounds,
+        [&](const std::string &frame, size_t i, bool verify) {
+            BinaryFrame bin;
+            Interpolator::EntityState state;
+            if (!DecodeBinaryFrame(frame, bin) ||
+                !decoders[i % CLIENTS].Decode(bin.type, bin.body, state))
+                return false;
+            check(verify, i, state);
+            return true;
+        });
+    for (DeltaDecoder &decoder : decoders) {
+        decoder.Reset(); // the snapshots start over from the keyframes
+    }
+    Run("snapshot", snapshots, CLIENTS, rounds,
+        [&](const std::string &frame, size_t i, bool verify) {
+            BinaryFrame bin, record;
+            Interpolator::EntityState state;
+            if (!DecodeBinaryFrame(frame, bin) || bin.type != FRAME_SNAPSHOT)
+                return false;
+            SnapshotReader reader(bin);
+            size_t c = 0;
+            for (; reader.Next(record); ++c) {
+                if (!decoders[c].Decode(record.type, record.body, state))
+                    return false;
+                check(verify, i * CLIENTS + c, state);
+            }
+            return c == CLIENTS;
+        });
+
+    return gFailures;
+}
@@ -0,0 +1,146 @@
+//
+//  deflateBench.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+// What permessage-deflate saves and costs for our traffic: the downlink of
+// 100 clients relayed at 20 Hz in each format, and our own uplink, for the
+// `ws_deflate_window_bits` and `ws_deflate_no_context_takeover` settings.
+// Uses the plugin's extension config on our side and websocketpp's plain
+// extension on the server's.
+
+#include "config.h"
+#include "protocol.h"
+#include "testUtil.h"
+#include "wsDeflate.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+constexpr int CLIENTS = 100;
+
+struct ServerDeflateConfig {};
+typedef websocketpp::extensions::permessage_deflate::enabled<
+    ServerDeflateConfig>
+    ServerDeflate;
+typedef deflate_asio_client::permessage_deflate_type ClientDeflate;
+
+/// Compresses `messages` in order with `deflater`, inflates them with
+/// `inflater`, checks they survive and prints bytes and time per message
+template <typename Deflater, typename Inflater>
+static void Run(const char *stream, int bits, bool noTakeover,
+                const std::vector<std::string> &messages, Deflater &deflater,
+                Inflater &inflater, bool ourSideInflates) {
+    std::string compressed, inflated;
+    size_t raw = 0, wire = 0;
+    int64_t deflateNs = 0, inflateNs = 0;
+    bool intact = true;
+    for (const std::string &message : messages) {
+        compressed.clear();
+        inflated.clear();
+        int64_t start = NowNs();
+        deflater.compress(message, compressed);
+        const int64_t deflated = NowNs();
+        inflater.decompress(
+            reinterpret_cast<const uint8_t *>(compressed.data()),
+            compressed.size(), inflated);
+        inflateNs += NowNs() - deflated;
+        deflateNs += deflated - start;
+        raw += message.size();
+        // The 00 00 ff ff of the sync flush doesn't go over the wire
+        wire += compressed.size() - 4;
+        intact = intact && inflated == message;
+    }
+    EXPECT(intact);
+    const double n = double(messages.size());
+    std::printf("%-14s %2d %-5s %7.1f -> %6.1f bytes (%5.1f%% saved)  "
+                "ours %5.2f us  server's %5.2f us\n",
+                stream, bits, noTakeover ? "reset" : "keep", raw / n,
+                wire / n, 100.0 * (1.0 - double(wire) / double(raw)),
+                (ourSideInflates ? inflateNs : deflateNs) / n / 1000.0,
+                (ourSideInflates ? deflateNs : inflateNs) / n / 1000.0);
+}
+
+int main(int argc, char **argv) {
+    const int ticks = QuickRun(argc, argv) ? 20 : 400;
+
+    // What the server relays to us, tick by tick, and what we send
+    std::vector<std::string> csv, pos, delta, snapshots;
+    std::vector<std::string> ownCsv, ownPos, ownDelta;
+    std::vector<DeltaEncoder> encoders(CLIENTS);
+    for (int t = 0; t < ticks; ++t) {
+        std::vector<std::string> tickDelta;
+        for (int c = 0; c < CLIENTS; ++c) {
+            const Interpolator::EntityState s = SyntheticState(c, t);
+            const std::string id = SyntheticId(c);
+            char text[CSV_POS_UP_MAX_SIZE];
+            uint8_t buf[MAX_UP_FRAME_SIZE];
+            const std::string textUp(text,
+                                     EncodeCsvPosReport(s, text, sizeof(text)));
+            const std::string posUp(
+                reinterpret_cast<char *>(buf),
+                EncodeBinaryPosReport(s, buf, sizeof(buf)));
+            csv.push_back(RelayCsv(textUp, s.timestamp, id));
+            pos.push_back(RelayBinary(posUp, s.timestamp, id));
+            const std::string deltaUp(
+                reinterpret_cast<char *>(buf),
+                encoders[c].Encode(s, buf, sizeof(buf)));
+            tickDelta.push_back(RelayBinary(deltaUp, s.timestamp, id));
+            if (c == 0) {
+                ownCsv.push_back(textUp);
+                ownPos.push_back(posUp);
+                ownDelta.push_back(deltaUp);
+            }
+        }
+        std::vector<BinaryFrame> records(CLIENTS);
+        for (int c = 0; c < CLIENTS; ++c) {
+            DecodeBinaryFrame(tickDelta[c], records[c]);
+        }
+        snapshots.push_back(SnapshotFrame(records[0].timestamp, records));
+        delta.insert(delta.end(), tickDelta.begin(), tickDelta.end());
+    }
+
+    std::printf("Per message: window bits, context kept or reset, size before "
+                "-> on the wire,\nCPU on our side and on the server's\n");
+    Config *config = Config::GetInstance();
+    for (bool noTakeover : {false, true}) {
+        for (int bits : {9, 12, 15}) {
+            struct Stream {
+                const char *name;
+                const std::vector<std::string> &messages;
+                bool down;
+            };
+            for (const Stream &stream :
+                 {Stream{"down csv", csv, true},
+                  Stream{"down binary", pos, true},
+                  Stream{"down delta", delta, true},
+                  Stream{"down snapshot", snapshots, true},
+                  Stream{"up csv", ownCsv, false},
+                  Stream{"up binary", ownPos, false},
+                  Stream{"up delta", ownDelta, false}}) {
+                // Fresh contexts per stream, like a new connection
+                config->wsDeflateWindowBits = bits;
+                config->wsDeflateNoContextTakeover = noTakeover;
+                ClientDeflate ours;
+                ServerDeflate server;
+                server.set_server_max_window_bits(
+                    uint8_t(bits),
+                    websocketpp::extensions::permessage_deflate::mode::accept);
+                if (noTakeover) {
+                    server.enable_server_no_context_takeover();
+                }
+                EXPECT(!ours.init(false) && !server.init(true));
+                if (stream.down) {
+                    Run(stream.name, bits, noTakeover, stream.messages, server,
+                        ours, true);
+                } else {
+                    Run(stream.name, bits, noTakeover, stream.messages, ours,
+                        server, false);
+                }
+            }
+        }
+    }
+    return gFailures;
+}
@@ -0,0 +1,183 @@
+//
+//  relay.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+
+#include "relay.h"
+#include "common.h"
+#include "testUtil.h"
+
+uint32_t Relay::Connect(std::string clientId, FrameFormat format,
+                        bool receive) {
+    Connection conn;
+    conn.clientId = std::move(clientId);
+    conn.format = format;
+    conn.receive = receive;
+    m_conns.push_back(std::move(conn));
+    return uint32_t(m_conns.size() - 1);
+}
+
+void Relay::Disconnect(uint32_t conn, int64_t nowMs) {
+    m_conns[conn].open = false;
+    const uint8_t up[] = {PROTO_VERSION, FRAME_LEAVE};
+    const std::string leave = RelayBinary(
+        {reinterpret_cast<const char *>(up), sizeof(up)}, nowMs,
+        m_conns[conn].clientId);
+    for (uint32_t to = 0; to < m_conns.size(); ++to) {
+        if (to != conn && m_conns[to].format != FORMAT_CSV) {
+            send(to, leave, true);
+        }
+    }
+}
+
+void Relay::OnFrame(uint32_t conn, std::string_view payload, bool binary,
+                    int64_t nowMs) {
+    Connection &from = m_conns[conn];
+    Interpolator::EntityState state;
+    state.timestamp = nowMs; // keyframes are re-encoded on server time
+    if (!binary) {
+        // Text frames only carry positions, decoded like a relayed one
+        PosReport report;
+        if (DecodeCsvPosReport(RelayCsv(payload, nowMs, from.clientId),
+                               report)) {
+            relayPos(conn, report.state, nowMs);
+        }
+        return;
+    }
+    if (payload.size() < 2 || uint8_t(payload[0]) != PROTO_VERSION) {
+        return;
+    }
+    const FrameType type = FrameType(payload[1]);
+    const std::string_view body = payload.substr(2);
+    switch (type) {
+    case FRAME_POS:
+        if (DecodeBinaryPosBody(body, state)) {
+            relayPos(conn, state, nowMs);
+        }
+        break;
+    case FRAME_KEY:
+    case FRAME_DELTA:
+        if (from.decoder.Decode(type, body, state)) {
+            relayPos(conn, state, nowMs);
+        }
+        break;
+    case FRAME_TIME: {
+        // Received and answered now: header time t2, t1 appended to t0
+        std::string reply = RelayBinary(payload, nowMs, "");
+        for (int i = 0; i < 8; ++i) {
+            reply += char(uint64_t(nowMs) >> (8 * i));
+        }
+        send(conn, reply, true);
+        break;
+    }
+    case FRAME_CONFIG:
+        relayConfig(conn, payload, nowMs);
+        break;
+    case FRAME_SUBSCRIBE:
+        if (DecodeSubscriptionBody(body, from.sub)) {
+            from.subscribed = true;
+        }
+        break;
+    default:
+        break; // ignored, like unknown types
+    }
+}
+
+bool Relay::wants(Connection &to, uint32_t from,
+                  const Interpolator::EntityState &state, int64_t nowMs,
+                  bool keyframe) {
+    if (!to.subscribed) {
+        return true;
+    }
+    const double distM =
+        GroundDistanceM(to.sub.lat, to.sub.lon, state.lat, state.lon);
+    if (distM > to.sub.radiusM) {
+        return false;
+    }
+    // Keyframes always go out, the deltas after them are relative to them
+    const uint16_t interval =
+        keyframe ? 0
+                 : to.sub.intervalMs[distM < to.sub.nearM ? 0
+                                     : distM < to.sub.midM ? 1
+                                                           : 2];
+    if (to.lastPosMs.size() <= from) {
+        to.lastPosMs.resize(m_conns.size(), INT64_MIN / 2);
+    }
+    if (nowMs - to.lastPosMs[from] < interval) {
+        return false;
+    }
+    to.lastPosMs[from] = nowMs;
+    return true;
+}
+
+void Relay::relayPos(uint32_t from, const Interpolator::EntityState &state,
+                     int64_t nowMs) {
+    Connection &sender = m_conns[from];
+    sender.last = state;
+    sender.hasPos = true;
+
+    // Each format encoded once for all receivers
+    char text[CSV_POS_UP_MAX_SIZE];
+    uint8_t pos[MAX_UP_FRAME_SIZE], delta[MAX_UP_FRAME_SIZE];
+    const std::string csvFrame = RelayCsv(
+        {text, EncodeCsvPosReport(state, text, sizeof(text))}, nowMs,
+        sender.clientId);
+    const std::string posFrame = RelayBinary(
+        {reinterpret_cast<char *>(pos),
+         EncodeBinaryPosReport(state, pos, sizeof(pos))},
+        nowMs, sender.clientId);
+    const std::string deltaFrame = RelayBinary(
+        {reinterpret_cast<char *>(delta),
+         sender.encoder.Encode(state, delta, sizeof(delta))},
+        nowMs, sender.clientId);
+    const bool keyframe = delta[1] == FRAME_KEY;
+
+    for (uint32_t to = 0; to < m_conns.size(); ++to) {
+        Connection &receiver = m_conns[to];
+        if (to == from || !receiver.open || !receiver.receive ||
+            !wants(receiver, from, state, nowMs,
+                   keyframe && receiver.format == FORMAT_DELTA)) {
+            continue;
+        }
+        switch (receiver.format) {
+        case FORMAT_CSV:
+            send(to, csvFrame, false);
+            break;
+        case FORMAT_BINARY:
+            send(to, posFrame, true);
+            break;
+        case FORMAT_DELTA:
+            send(to, deltaFrame, true);
+            break;
+        }
+    }
+}
+
+void Relay::relayConfig(uint32_t from, std::string_view up, int64_t nowMs) {
+    const Connection &sender = m_conns[from];
+    const std::string frame = RelayBinary(up, nowMs, sender.clientId);
+    for (uint32_t to = 0; to < m_conns.size(); ++to) {
+        Connection &receiver = m_conns[to];
+        if (to == from || !receiver.open || !receiver.receive ||
+            receiver.format == FORMAT_CSV) {
+            continue;
+        }
+        // Outside the region only if we know it is
+        if (receiver.subscribed && sender.hasPos &&
+            GroundDistanceM(receiver.sub.lat, receiver.sub.lon,
+                            sender.last.lat,
+                            sender.last.lon) > receiver.sub.radiusM) {
+            continue;
+        }
+        send(to, frame, true);
+    }
+}
+
+void Relay::send(uint32_t conn, std::string_view frame, bool binary) {
+    Connection &to = m_conns[conn];
+    ++to.sent.frames;
+    to.sent.bytes += frame.size();
+    m_send(conn, frame, binary);
+}
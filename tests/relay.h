@@ -0,0 +1,91 @@
+//
+//  relay.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "protocol.h"
+
+/// The server's side of the protocol without the networking, for the test
+/// server and tests: relays each client's reports and configuration to the
+/// other connections in the format they negotiated, honouring their
+/// `FRAME_SUBSCRIBE` regions and intervals, answers `FRAME_TIME` and counts
+/// what it sends. Not thread safe.
+class Relay {
+  public:
+    /// Sends `frame` to connection `conn`
+    typedef std::function<void(uint32_t conn, std::string_view frame,
+                               bool binary)>
+        SendFn;
+
+    /// What a connection was sent
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+    };
+
+    explicit Relay(SendFn send) : m_send(std::move(send)) {}
+
+    /// A client connected with the format its subprotocol selected.
+    /// Clients that don't `receive` only send, like synthetic ones.
+    /// @return Its connection number
+    uint32_t Connect(std::string clientId, FrameFormat format,
+                     bool receive = true);
+    /// A client disconnected, the others are told with `FRAME_LEAVE`
+    void Disconnect(uint32_t conn, int64_t nowMs);
+    /// A frame from connection `conn`, received at server time `nowMs`
+    void OnFrame(uint32_t conn, std::string_view payload, bool binary,
+                 int64_t nowMs);
+
+    const Stats &SentTo(uint32_t conn) const { return m_conns[conn].sent; }
+    bool IsSubscribed(uint32_t conn) const {
+        return m_conns[conn].subscribed;
+    }
+    const std::string &ClientId(uint32_t conn) const {
+        return m_conns[conn].clientId;
+    }
+    FrameFormat Format(uint32_t conn) const { return m_conns[conn].format; }
+
+  private:
+    struct Connection {
+        std::string clientId;
+        FrameFormat format = FORMAT_CSV;
+        bool receive = true;
+        bool open = true;
+        bool subscribed = false;
+        Subscription sub;
+        // As a sender: its key/delta uplink, and its reports re-encoded
+        // for key/delta receivers
+        DeltaDecoder decoder;
+        DeltaEncoder encoder;
+        Interpolator::EntityState last{};
+        bool hasPos = false;
+        // As a receiver: when each sender's report went out last
+        std::vector<int64_t> lastPosMs;
+        Stats sent;
+    };
+
+    void relayPos(uint32_t from, const Interpolator::EntityState &state,
+                  int64_t nowMs);
+    void relayConfig(uint32_t from, std::string_view up, int64_t nowMs);
+    /// Whether a report at `state` goes to `to` now, by its subscription.
+    /// A `keyframe` isn't thinned, only checked against the region.
+    bool wants(Connection &to, uint32_t from,
+               const Interpolator::EntityState &state, int64_t nowMs,
+               bool keyframe);
+    void send(uint32_t conn, std::string_view frame, bool binary);
+
+    std::vector<Connection> m_conns;
+    SendFn m_send;
+};
+
+#endif // RELAY_H
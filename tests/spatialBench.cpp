@@ -0,0 +1,146 @@
+//
+//  spatialBench.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+// SpatialIndex with MAX_PEERS synthetic planes, crowded around one event or
+// spread over the world: cost of moving them all each frame, and of radius
+// and nearest queries against a scan of all planes, results checked against
+// the scan
+
+#include "common.h"
+#include "lod.h"
+#include "spatialIndex.h"
+#include "testUtil.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+constexpr size_t NEAREST_K = 8;
+
+struct Pos {
+    double lat, lon;
+};
+
+/// Slots within `radiusM` of `at`, by scanning all of them
+static size_t ScanRadius(const std::vector<Pos> &planes, Pos at,
+                         double radiusM) {
+    size_t found = 0;
+    for (const Pos &p : planes) {
+        found += GroundDistanceM(at.lat, at.lon, p.lat, p.lon) <= radiusM;
+    }
+    return found;
+}
+
+/// Distances of the `k` nearest slots, by scanning all of them
+static std::vector<double> ScanNearest(const std::vector<Pos> &planes,
+                                       Pos at, size_t k) {
+    std::vector<double> dist;
+    for (const Pos &p : planes) {
+        dist.push_back(GroundDistanceM(at.lat, at.lon, p.lat, p.lon));
+    }
+    k = std::min(k, dist.size());
+    std::partial_sort(dist.begin(), dist.begin() + k, dist.end());
+    dist.resize(k);
+    return dist;
+}
+
+/// Runs `fn` `n` times, returns ns per run
+template <typename Fn> static double Time(int n, Fn &&fn) {
+    const int64_t start = NowNs();
+    for (int i = 0; i < n; ++i) {
+        fn(i);
+    }
+    return double(NowNs() - start) / n;
+}
+
+static void Run(const char *name, int frames,
+                std::vector<Pos> (*planesAt)(int frame)) {
+    static SpatialIndex index; // too large for the stack
+    for (uint16_t slot = 0; slot < MAX_PEERS; ++slot) {
+        index.Remove(slot);
+    }
+    const Pos own{47.0, 8.0};
+    uint16_t slots[MAX_PEERS];
+    double dist[SPATIAL_MAX_NEAREST];
+    double updateNs = 0, lodNs = 0, nearNs = 0, knnNs = 0;
+    double scanLodNs = 0, scanKnnNs = 0;
+    size_t lodCount = 0;
+
+    for (int frame = 0; frame < frames; ++frame) {
+        const std::vector<Pos> planes = planesAt(frame);
+        updateNs += Time(MAX_PEERS, [&](int slot) {
+            index.Update(uint16_t(slot), planes[slot].lat, planes[slot].lon);
+        });
+        // A LOD round, the summary log's near count and nearest plane
+        size_t found = 0;
+        lodNs += Time(1, [&](int) {
+            found = index.Radius(own.lat, own.lon, LOD_MID_M * LOD_HYSTERESIS,
+                                 slots, MAX_PEERS);
+        });
+        lodCount += found;
+        nearNs += Time(1, [&](int) {
+            index.Radius(own.lat, own.lon, LOD_NEAR_M, slots, MAX_PEERS);
+        });
+        size_t k = 0;
+        knnNs += Time(1, [&](int) {
+            k = index.Nearest(own.lat, own.lon, NEAREST_K, slots, dist);
+        });
+
+        size_t scanned = 0;
+        scanLodNs += Time(1, [&](int) {
+            scanned = ScanRadius(planes, own, LOD_MID_M * LOD_HYSTERESIS);
+        });
+        std::vector<double> scanDist;
+        scanKnnNs += Time(1, [&](int) {
+            scanDist = ScanNearest(planes, own, NEAREST_K);
+        });
+        EXPECT(found == scanned);
+        EXPECT(k == scanDist.size() &&
+               std::equal(dist, dist + k, scanDist.begin()));
+    }
+    EXPECT(index.Count() == MAX_PEERS);
+
+    std::printf("%s, %u planes, %.1f within mid range:\n", name,
+                unsigned(MAX_PEERS), double(lodCount) / frames);
+    std::printf("  update    %6.1f ns/plane %7.1f us/frame\n",
+                updateNs / frames, updateNs * MAX_PEERS / frames / 1000.0);
+    std::printf("  radius    %6.1f us mid range, %.1f us near, "
+                "scan %.1f us\n",
+                lodNs / frames / 1000.0, nearNs / frames / 1000.0,
+                scanLodNs / frames / 1000.0);
+    std::printf("  nearest %zu %6.1f us, scan %.1f us\n", NEAREST_K,
+                knnNs / frames / 1000.0, scanKnnNs / frames / 1000.0);
+}
+
+/// Everybody within 100 km of 47N 8E, flying circles
+static std::vector<Pos> EventPlanes(int frame) {
+    std::vector<Pos> planes;
+    for (int c = 0; c < MAX_PEERS; ++c) {
+        const Interpolator::EntityState s = SyntheticState(c, frame);
+        planes.push_back({s.lat, s.lon});
+    }
+    return planes;
+}
+
+/// Spread between 60S and 60N, drifting east
+static std::vector<Pos> WorldPlanes(int frame) {
+    std::mt19937 rng(23);
+    std::uniform_real_distribution<double> lat(-60.0, 60.0), lon(-180, 180);
+    std::vector<Pos> planes;
+    for (int c = 0; c < MAX_PEERS; ++c) {
+        planes.push_back({lat(rng), lon(rng) + frame * 1e-4});
+    }
+    return planes;
+}
+
+int main(int argc, char **argv) {
+    const int frames = QuickRun(argc, argv) ? 20 : 500;
+    Run("Event", frames, EventPlanes);
+    Run("World", frames, WorldPlanes);
+    return gFailures;
+}
@@ -0,0 +1,160 @@
+//
+//  subscriptionTest.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+// The relay honours FRAME_SUBSCRIBE: 1000 synthetic clients report at 20 Hz,
+// observers subscribed to a 30 km region only get the clients in it, full
+// reports and deltas thinned by distance, keyframes never. Prints what that
+// saves compared to an observer that didn't subscribe.
+
+#include "common.h"
+#include "protocol.h"
+#include "relay.h"
+#include "testUtil.h"
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+constexpr int CLIENTS = 1000;
+constexpr int TICKS = 600; // 30 s
+constexpr int64_t START_MS = 1700000000000LL;
+
+/// What an observer got from one client
+struct Received {
+    DeltaDecoder decoder;
+    int64_t lastMs = 0;
+    int lastTick = -1;
+    bool keyed = false; ///< got a keyframe, `keySeq` being its sequence
+    uint8_t keySeq = 0;
+};
+
+int main() {
+    Subscription sub;
+    sub.lat = 47.0;
+    sub.lon = 8.0;
+    sub.radiusM = 30000.0f;
+    sub.nearM = 5000.0f;
+    sub.midM = 20000.0f;
+    sub.intervalMs[1] = 100;
+    sub.intervalMs[2] = 250;
+
+    std::map<std::string, Received> gotBinary, gotDelta;
+    uint64_t inRegion = 0, deltaReports = 0, deltaDecoded = 0,
+             binaryReports = 0, allReports = 0;
+    int tick = 0;
+    uint32_t binaryObserver = 0, deltaObserver = 0, allObserver = 0;
+
+    Relay relay([&](uint32_t conn, std::string_view payload, bool binary) {
+        BinaryFrame frame;
+        EXPECT(binary && DecodeBinaryFrame(payload, frame));
+        const int64_t nowMs = frame.timestamp;
+        Interpolator::EntityState state;
+        if (frame.type == FRAME_LEAVE) {
+            return;
+        }
+        if (conn == allObserver) {
+            ++allReports;
+        } else if (conn == binaryObserver) {
+            ++binaryReports;
+            EXPECT(frame.type == FRAME_POS &&
+                   DecodeBinaryPosBody(frame.body, state));
+            const double distM =
+                GroundDistanceM(sub.lat, sub.lon, state.lat, state.lon);
+            EXPECT(distM <= sub.radiusM);
+            // No sooner than its distance band asks for
+            Received &got = gotBinary[std::string(frame.clientId)];
+            const int band = distM < sub.nearM ? 0 : distM < sub.midM ? 1 : 2;
+            EXPECT(got.lastTick < 0 ||
+                   nowMs - got.lastMs >= sub.intervalMs[band]);
+            got.lastMs = nowMs;
+            got.lastTick = tick;
+        } else if (conn == deltaObserver) {
+            ++deltaReports;
+            Received &got = gotDelta[std::string(frame.clientId)];
+            EXPECT(!frame.body.empty());
+            const uint8_t seq = uint8_t(frame.body[0]);
+            const bool decoded =
+                got.decoder.Decode(frame.type, frame.body, state);
+            if (frame.type == FRAME_KEY) {
+                got.keyed = decoded;
+                got.keySeq = seq;
+            }
+            // A delta decodes exactly if we got its keyframe, no matter how
+            // many deltas in between were thinned out
+            EXPECT(decoded == (frame.type == FRAME_KEY ||
+                               (got.keyed && seq == got.keySeq)));
+            if (decoded) {
+                ++deltaDecoded;
+                const double distM =
+                    GroundDistanceM(sub.lat, sub.lon, state.lat, state.lon);
+                EXPECT(distM <= sub.radiusM);
+                // Deltas no sooner than the distance band asks for
+                const int band =
+                    distM < sub.nearM ? 0 : distM < sub.midM ? 1 : 2;
+                EXPECT(frame.type == FRAME_KEY || got.lastTick < 0 ||
+                       nowMs - got.lastMs >= sub.intervalMs[band]);
+            }
+            got.lastMs = nowMs;
+            got.lastTick = tick;
+        }
+    });
+
+    std::vector<uint32_t> senders;
+    std::vector<DeltaEncoder> encoders(CLIENTS);
+    for (int c = 0; c < CLIENTS; ++c) {
+        senders.push_back(
+            relay.Connect(SyntheticId(c), FORMAT_DELTA, false));
+    }
+    binaryObserver = relay.Connect("observer-binary", FORMAT_BINARY);
+    deltaObserver = relay.Connect("observer-delta", FORMAT_DELTA);
+    allObserver = relay.Connect("observer-all", FORMAT_DELTA);
+
+    uint8_t buf[MAX_UP_FRAME_SIZE];
+    for (uint32_t observer : {binaryObserver, deltaObserver}) {
+        const size_t len = EncodeSubscription(sub, buf, sizeof(buf));
+        relay.OnFrame(observer, {reinterpret_cast<char *>(buf), len}, true,
+                      START_MS);
+        EXPECT(relay.IsSubscribed(observer));
+    }
+    EXPECT(!relay.IsSubscribed(allObserver));
+
+    for (tick = 0; tick < TICKS; ++tick) {
+        for (int c = 0; c < CLIENTS; ++c) {
+            const Interpolator::EntityState s = SyntheticState(c, tick);
+            inRegion += GroundDistanceM(sub.lat, sub.lon, s.lat, s.lon) <=
+                        sub.radiusM;
+            const size_t len = encoders[c].Encode(s, buf, sizeof(buf));
+            relay.OnFrame(senders[c], {reinterpret_cast<char *>(buf), len},
+                          true, s.timestamp);
+        }
+    }
+
+    // Both subscribers get the region thinned, the observer that didn't
+    // subscribe everything. Nearly all deltas decode, only those from clients
+    // that came into the region after their last keyframe don't.
+    EXPECT(allReports == uint64_t(CLIENTS) * TICKS);
+    EXPECT(binaryReports < inRegion);
+    EXPECT(deltaReports < inRegion);
+    std::printf("delta observer decoded %.1f%% of %llu reports\n",
+                100.0 * double(deltaDecoded) / double(deltaReports),
+                (unsigned long long)deltaReports);
+    EXPECT(deltaDecoded * 10 >= deltaReports * 9);
+
+    // A leaving client is announced to everybody
+    const uint64_t before = relay.SentTo(deltaObserver).frames;
+    relay.Disconnect(senders[0], START_MS + TICKS * 50);
+    EXPECT(relay.SentTo(deltaObserver).frames == before + 1);
+
+    const double seconds = TICKS / 20.0;
+    for (uint32_t observer : {allObserver, deltaObserver, binaryObserver}) {
+        const Relay::Stats &sent = relay.SentTo(observer);
+        std::printf("%-16s %7.0f frames/s %9.0f bytes/s\n",
+                    relay.ClientId(observer).c_str(), sent.frames / seconds,
+                    sent.bytes / seconds);
+    }
+    return gFailures;
+}
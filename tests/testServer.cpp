@@ -0,0 +1,168 @@
+//
+//  testServer.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+// A local relay server to run the plugin against, for measuring offline what
+// subscriptions and formats save. Honours FRAME_SUBSCRIBE like the real one
+// should, and can add synthetic clients circling near 47N 8E.
+//
+//   testServer [port] [synthetic clients]
+//
+// Point the plugin at it with `server_uri=ws://localhost:9002/?auth=` in its
+// config file. Every 10 s it prints what each connection was sent.
+
+#include "relay.h"
+#include "testUtil.h"
+
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/server.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+typedef websocketpp::server<websocketpp::config::asio> WsServer;
+
+/// Synthetic clients report at 20 Hz, stats go out every 10 s
+constexpr long TICK_MS = 50;
+constexpr int STATS_TICKS = 200;
+
+static int64_t ServerNow() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+int main(int argc, char **argv) {
+    const uint16_t port = uint16_t(argc > 1 ? std::atoi(argv[1]) : 9002);
+    const int synthetic = argc > 2 ? std::atoi(argv[2]) : 0;
+
+    WsServer server;
+    server.clear_access_channels(websocketpp::log::alevel::all);
+    server.set_error_channels(websocketpp::log::elevel::fatal);
+    server.init_asio();
+    server.set_reuse_addr(true);
+
+    std::vector<websocketpp::connection_hdl> hdls;
+    std::map<websocketpp::connection_hdl, uint32_t,
+             std::owner_less<websocketpp::connection_hdl>>
+        conns;
+    int64_t relayNs = 0;
+    Relay relay([&](uint32_t conn, std::string_view frame, bool binary) {
+        websocketpp::lib::error_code ec;
+        server.send(hdls[conn], frame.data(), frame.size(),
+                    binary ? websocketpp::frame::opcode::binary
+                           : websocketpp::frame::opcode::text,
+                    ec);
+    });
+    auto onFrame = [&](uint32_t conn, std::string_view payload, bool binary) {
+        const int64_t start = NowNs();
+        relay.OnFrame(conn, payload, binary, ServerNow());
+        relayNs += NowNs() - start;
+    };
+
+    // Synthetic clients send only, they have no connection
+    std::vector<uint32_t> synthConns;
+    std::vector<DeltaEncoder> synthEncoders(synthetic);
+    for (int c = 0; c < synthetic; ++c) {
+        synthConns.push_back(
+            relay.Connect(SyntheticId(c), FORMAT_DELTA, false));
+        hdls.emplace_back();
+    }
+
+    // The client's preferred subprotocol we know, else CSV
+    server.set_validate_handler([&](websocketpp::connection_hdl hdl) {
+        WsServer::connection_ptr con = server.get_con_from_hdl(hdl);
+        for (const std::string &offered : con->get_requested_subprotocols()) {
+            if (offered == SUBPROTO_DELTA || offered == SUBPROTO_BINARY) {
+                con->select_subprotocol(offered);
+                break;
+            }
+        }
+        return true;
+    });
+    server.set_open_handler([&](websocketpp::connection_hdl hdl) {
+        WsServer::connection_ptr con = server.get_con_from_hdl(hdl);
+        const std::string &subprotocol = con->get_subprotocol();
+        const FrameFormat format = subprotocol == SUBPROTO_DELTA ? FORMAT_DELTA
+                                   : subprotocol == SUBPROTO_BINARY
+                                       ? FORMAT_BINARY
+                                       : FORMAT_CSV;
+        // The real server knows clients by their token
+        const std::string &resource = con->get_resource();
+        const size_t auth = resource.find("auth=");
+        std::string clientId = auth == std::string::npos
+                                   ? std::string()
+                                   : resource.substr(auth + 5);
+        if (clientId.empty()) {
+            clientId = "client-" + std::to_string(hdls.size());
+        }
+        conns[hdl] = relay.Connect(clientId, format);
+        hdls.push_back(hdl);
+        std::printf("%s connected, %s\n", clientId.c_str(),
+                    subprotocol.empty() ? "csv" : subprotocol.c_str());
+    });
+    server.set_close_handler([&](websocketpp::connection_hdl hdl) {
+        const uint32_t conn = conns[hdl];
+        relay.Disconnect(conn, ServerNow());
+        conns.erase(hdl);
+        std::printf("%s disconnected\n", relay.ClientId(conn).c_str());
+    });
+    server.set_message_handler(
+        [&](websocketpp::connection_hdl hdl, WsServer::message_ptr msg) {
+            onFrame(conns[hdl], msg->get_payload(),
+                    msg->get_opcode() == websocketpp::frame::opcode::binary);
+        });
+
+    // Synthetic reports and stats
+    int tick = 0;
+    std::vector<Relay::Stats> lastStats;
+    std::function<void(const websocketpp::lib::error_code &)> onTick =
+        [&](const websocketpp::lib::error_code &ec) {
+            if (ec) {
+                return;
+            }
+            uint8_t buf[MAX_UP_FRAME_SIZE];
+            for (int c = 0; c < synthetic; ++c) {
+                const size_t len = synthEncoders[c].Encode(
+                    SyntheticState(c, tick), buf, sizeof(buf));
+                onFrame(synthConns[c], {reinterpret_cast<char *>(buf), len},
+                        true);
+            }
+            if (++tick % STATS_TICKS == 0) {
+                const double seconds = STATS_TICKS * TICK_MS / 1000.0;
+                std::printf("relay CPU %.1f%%\n", relayNs / seconds / 1e7);
+                relayNs = 0;
+                lastStats.resize(hdls.size());
+                for (const auto &entry : conns) {
+                    const uint32_t conn = entry.second;
+                    const Relay::Stats &sent = relay.SentTo(conn);
+                    std::printf(
+                        "  %-20s %-8s %s %7.0f frames/s %9.0f bytes/s\n",
+                        relay.ClientId(conn).c_str(),
+                        relay.Format(conn) == FORMAT_DELTA    ? "delta"
+                        : relay.Format(conn) == FORMAT_BINARY ? "binary"
+                                                              : "csv",
+                        relay.IsSubscribed(conn) ? "subscribed" : "all       ",
+                        (sent.frames - lastStats[conn].frames) / seconds,
+                        (sent.bytes - lastStats[conn].bytes) / seconds);
+                    lastStats[conn] = sent;
+                }
+                std::fflush(stdout);
+            }
+            server.set_timer(TICK_MS, onTick);
+        };
+    server.set_timer(TICK_MS, onTick);
+
+    server.listen(port);
+    server.start_accept();
+    std::printf("Listening on port %u with %d synthetic clients\n",
+                unsigned(port), synthetic);
+    std::fflush(stdout);
+    server.run();
+    return 0;
+}
@@ -0,0 +1,114 @@
+//
+//  testUtil.cpp
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+
+#include "testUtil.h"
+#include "common.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+int gFailures = 0;
+
+static std::atomic<size_t> s_allocCount{0};
+
+void *operator new(size_t size) {
+    ++s_allocCount;
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+size_t AllocCount() { return s_allocCount.load(); }
+
+/// The plugin logs to X-Plane's Log.txt, tests to stderr
+void LogMsg(const char *szMsg, ...) {
+    va_list args;
+    va_start(args, szMsg);
+    std::vfprintf(stderr, szMsg, args);
+    va_end(args);
+    std::fputc('\n', stderr);
+}
+
+bool QuickRun(int argc, char **argv) {
+    return argc > 1 && std::strcmp(argv[1], "--quick") == 0;
+}
+
+Interpolator::EntityState SyntheticState(int client, int tick) {
+    // Spread over a 100 km square by a fixed pseudo-random per client
+    const uint32_t h = uint32_t(client) * 2654435761u;
+    const double lat0 = 47.0 + ((h & 0xffff) / 65535.0 - 0.5) * 0.9;
+    const double lon0 = 8.0 + ((h >> 16) / 65535.0 - 0.5) * 1.3;
+    const double radiusM = 3000.0;
+    const double angle = (client % 7) + tick * 0.05 * 150.0 / radiusM;
+
+    Interpolator::EntityState s;
+    s.timestamp = 1700000000000LL + tick * 50;
+    s.lat = lat0 + radiusM * std::sin(angle) / M_PER_DEG_LAT;
+    s.lon = lon0 + radiusM * std::cos(angle) /
+                       (M_PER_DEG_LAT * std::cos(deg2rad(lat0)));
+    s.el = 1500.0 + (client % 50) * 100.0;
+    s.heading = std::fmod(360.0 + 90.0 - angle * 180.0 / PI, 360.0);
+    s.pitch = 1.5;
+    s.roll = -20.0;
+    return s;
+}
+
+std::string SyntheticId(int client) {
+    char buf[24];
+    std::snprintf(buf, sizeof(buf), "player-%04d", client);
+    return buf;
+}
+
+static void Put(std::string &out, uint64_t val, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out += char(val >> (8 * i));
+    }
+}
+
+std::string RelayBinary(std::string_view up, int64_t ts,
+                        std::string_view clientId) {
+    std::string out(up.substr(0, 2));
+    Put(out, uint64_t(ts), 8);
+    Put(out, clientId.size(), 1);
+    out += clientId;
+    out += up.substr(2);
+    return out;
+}
+
+std::string RelayCsv(std::string_view up, int64_t ts,
+                     std::string_view clientId) {
+    std::string out = std::to_string(ts);
+    out += ',';
+    out += clientId;
+    out += ',';
+    out += up;
+    return out;
+}
+
+std::string SnapshotFrame(int64_t ts, const std::vector<BinaryFrame> &records) {
+    std::string out;
+    Put(out, PROTO_VERSION, 1);
+    Put(out, FRAME_SNAPSHOT, 1);
+    Put(out, uint64_t(ts), 8);
+    Put(out, 0, 1); // no client ID, the server's own
+    Put(out, records.size(), 2);
+    for (const BinaryFrame &record : records) {
+        Put(out, record.type, 1);
+        Put(out, record.clientId.size(), 1);
+        out += record.clientId;
+        Put(out, record.body.size(), 2);
+        out += record.body;
+    }
+    return out;
+}
@@ -0,0 +1,63 @@
+//
+//  testUtil.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "protocol.h"
+
+/// Counts a failed check and tells where, doesn't stop the test
+#define EXPECT(cond)                                                           \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            std::fprintf(stderr, "%s:%d: EXPECT(%s) failed\n", __FILE__,       \
+                         __LINE__, #cond);                                     \
+            ++gFailures;                                                       \
+        }                                                                      \
+    } while (0)
+
+/// Number of failed `EXPECT`s, the test's exit code if not 0
+extern int gFailures;
+
+/// Heap allocations so far, counted by the replaced global `operator new`
+size_t AllocCount();
+
+/// Monotonic time for benchmarks [ns]
+inline int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/// Whether the benchmark should only run briefly, as it does in ctest
+bool QuickRun(int argc, char **argv);
+
+/// State of synthetic client `client` at tick `tick` (20 Hz): everybody
+/// circles somewhere within 100 km of a common center, at 150 m/s
+Interpolator::EntityState SyntheticState(int client, int tick);
+
+/// Client ID of synthetic client `client`
+std::string SyntheticId(int client);
+
+/// The server's relay of a client's binary frame `up`: its header with the
+/// timestamp and the client ID inserted after the type, see `BinaryFrame`
+std::string RelayBinary(std::string_view up, int64_t ts,
+                        std::string_view clientId);
+/// The server's relay of a client's text frame: `ts,clientId,` in front
+std::string RelayCsv(std::string_view up, int64_t ts,
+                     std::string_view clientId);
+/// A `FRAME_SNAPSHOT` bundling relayed binary frames of one tick
+std::string SnapshotFrame(int64_t ts, const std::vector<BinaryFrame> &records);
+
+#endif // TEST_UTIL_H
@@ -8,6 +8,7 @@
 #include "util.h"
 
 bool gbFreeze = false;
+RenderContext gRenderCtx;
 
 /// Log a message to X-Plane's Log.txt with sprintf-style parameters
 void LogMsg(const char *szMsg, ...) {
@@ -86,33 +87,21 @@ void DebugListLoadedSoundNames() {
 }
 #endif
 
-/// Returns a number between 0.0 and 1.0, increasing over the course of 10
-/// seconds, then restarting
-float GetTimeFragment() {
-    static float lastVal = 0.0f;
+void UpdateRenderContext(int64_t serverTimeMs) {
+    gRenderCtx.serverTimeMs = serverTimeMs;
 
-    // Just keep returning last value while frozen
+    // Just keep the last values while frozen
     if (gbFreeze)
-        return lastVal;
+        return;
 
-    const float t = XPLMGetDataf(dr_time);
-    return lastVal = std::fmod(t, PLANE_CIRCLE_TIME_S) / PLANE_CIRCLE_TIME_S;
+    gRenderCtx.timeFragment =
+        std::fmod(XPLMGetDataf(dr_time), PLANE_CIRCLE_TIME_S) /
+        PLANE_CIRCLE_TIME_S;
 }
 
-/// Returns a number between 0.0 and 1.0, going up and down over the course of
-/// 10 seconds
-float GetTimeUpDown() {
-    static float lastVal = 0.0f;
-
-    // Just keep returning last value while frozen
-    if (gbFreeze)
-        return lastVal;
-
-    return lastVal =
-               std::abs(std::fmod(XPLMGetDataf(dr_time), PLANE_CIRCLE_TIME_S) /
-                            (PLANE_CIRCLE_TIME_S / 2.0f) -
-                        1.0f);
-}
+/// Returns a number between 0.0 and 1.0, increasing over the course of 10
+/// seconds, then restarting
+float GetTimeFragment() { return gRenderCtx.timeFragment; }
 
 /// Finds a position 200m in front of the user's plane serving as the center for
 /// further operations
@@ -142,39 +131,3 @@ void ConvLocalToWorld(const positionTy &pos, double &lat, double &lon,
                       double &alt) {
     XPLMLocalToWorld(pos.x, pos.y, pos.z, &lat, &lon, &alt);
 }
-
-std::string GetTokenFromFile(const std::string fullPath) {
-    std::ifstream infile(fullPath);
-    if (!infile.is_open()) {
-        std::cerr << "Unable to open file: " << fullPath << std::endl;
-        return "";
-    }
-
-    std::string line;
-    if (std::getline(infile, line)) {
-        // Find the position of the '=' character.
-        size_t pos = line.find('=');
-        if (pos != std::string::npos && pos + 1 < line.size()) {
-            // Return everything after '='.
-            return line.substr(pos + 1);
-        } else {
-            std::cerr << "The line does not contain '=' or no value follows it."
-                      << std::endl;
-        }
-    } else {
-        std::cerr << "Failed to read a line from the file." << std::endl;
-    }
-    return "";
-}
-
-
-// Splits 'str' using the specified delimiter character.
-std::vector<std::string> splitString(const std::string& str, char delimiter) {
-    std::vector<std::string> tokens;
-    std::stringstream ss(str);
-    std::string token;
-    while (std::getline(ss, token, delimiter)) {
-        tokens.push_back(token);
-    }
-    return tokens;
-}
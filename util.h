@@ -29,14 +29,13 @@
 #include "XPMPAircraft.h"
 #include "XPMPMultiplayer.h"
 
+#include "common.h"
+
 #define PLUGIN_NAME "fly-with-me"
 
 /// Freeze all movements at the moment?
 extern bool gbFreeze;
 
-/// PI
-constexpr double PI = 3.1415926535897932384626433832795028841971693993751;
-
 /// Position of user's plane
 static XPLMDataRef dr_x =
     XPLMFindDataRef("sim/flightmodel/position/local_x"); // double
@@ -65,16 +64,26 @@ constexpr float PLANE_TIRE_CIRCUMFENCE_M = 3.2f;
 /// Engine / prop rotation assumptions: rotations per minute
 constexpr float PLANE_PROP_RPM = 300.0f;
 
-void LogMsg(const char *szMsg, ...);
 int CBIntPrefsFunc(const char *, [[maybe_unused]] const char *item,
                    int defaultVal);
 void CBPlaneNotifier(XPMPPlaneID inPlaneID,
                      XPMPPlaneNotification inNotification, void * /*inRefcon*/);
 void DebugListLoadedSoundNames();
 
-float GetTimeFragment();
+/// What all aircraft updates of one frame share, so that each of them
+/// doesn't read clocks and datarefs again
+struct RenderContext {
+    /// Server time remote aircraft are rendered for, from a monotonic clock
+    int64_t serverTimeMs = 0;
+    /// See GetTimeFragment
+    float timeFragment = 0.0f;
+};
+extern RenderContext gRenderCtx;
 
-float GetTimeUpDown();
+/// Sets gRenderCtx for this frame, before any aircraft is updated
+void UpdateRenderContext(int64_t serverTimeMs);
+
+float GetTimeFragment();
 
 /// Summarizes the 3 values of a position in the local coordinate system
 struct positionTy {
@@ -92,8 +101,6 @@ void ConvLocalToWorld(const positionTy &pos, double &lat, double &lon,
 /// further operations
 positionTy FindCenterPos(float dist);
 
-/// Convert from degree to radians
-inline double deg2rad(const double deg) { return (deg * PI / 180.0); }
 /// Save string copy
 inline char *strScpy(char *dest, const char *src, size_t size) {
     strncpy(dest, src, size);
@@ -101,8 +108,4 @@ inline char *strScpy(char *dest, const char *src, size_t size) {
     return dest;
 }
 
-std::string GetTokenFromFile(const std::string filePath);
-
-std::vector<std::string> splitString(const std::string& str, char delimiter);
-
 #endif // UTIL_H
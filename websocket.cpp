@@ -17,6 +17,9 @@
 WebSocketClient::WebSocketClient() {
     m_client.init_asio();
     m_client.start_perpetual();
+    m_sendTimer =
+        std::make_unique<asio::steady_timer>(m_client.get_io_service());
+    scheduleSendTick();
 
     // Bind the event handlers to the class member functions.
     m_client.set_open_handler(
@@ -39,6 +42,7 @@ WebSocketClient::WebSocketClient() {
 
 // Destructor: stops the perpetual run and joins the thread.
 WebSocketClient::~WebSocketClient() {
+    asio::post(m_client.get_io_service(), [this]() { m_sendTimer->cancel(); });
     m_client.stop_perpetual();
     if (m_thread.joinable()) {
         m_thread.join();
@@ -61,6 +65,7 @@ void WebSocketClient::connect(const std::string &uri) {
         LogMsg("WebSocket Conn Failed: %s", ec.message().c_str());
         return;
     }
+    offerSubprotocols(con);
     m_hdl = con->get_handle();
     m_client.connect(con);
 }
@@ -84,14 +89,54 @@ void WebSocketClient::reconnect() {
         }).detach();
         return;
     }
+    offerSubprotocols(con);
     m_hdl = con->get_handle();
     m_client.connect(con);
 }
 
+// Drives the send path every POS_LOOP_INTERVAL, on the asio thread. The sim
+// only hands over its latest state, so it never waits for networking.
+void WebSocketClient::scheduleSendTick() {
+    m_sendTimer->expires_after(std::chrono::milliseconds(
+        static_cast<int>(POS_LOOP_INTERVAL * 1000.0f)));
+    m_sendTimer->async_wait([this](const asio::error_code &ec) {
+        if (ec) {
+            return; // cancelled on shutdown
+        }
+        if (m_open) {
+            AppState::GetInstance()->OnSendTick();
+        }
+        scheduleSendTick();
+    });
+}
+
+// Offers the binary frame formats in order of preference, the server selects
+// one of them or ignores them
+void WebSocketClient::offerSubprotocols(ws_client::connection_ptr con) {
+    for (const char *subprotocol : {SUBPROTO_DELTA, SUBPROTO_BINARY}) {
+        websocketpp::lib::error_code ec;
+        con->add_subprotocol(subprotocol, ec);
+        if (ec) {
+            LogMsg("Cannot offer subprotocol %s: %s", subprotocol,
+                   ec.message().c_str());
+        }
+    }
+}
+
 // Sends a text message to the WebSocket server.
-void WebSocketClient::send(const std::string &message) {
+void WebSocketClient::send(std::string_view message) {
+    websocketpp::lib::error_code ec;
+    m_client.send(m_hdl, message.data(), message.size(),
+                  websocketpp::frame::opcode::text, ec);
+    if (ec) {
+        LogMsg("Send Error: %s", ec.message().c_str());
+    }
+}
+
+// Sends a binary message to the WebSocket server.
+void WebSocketClient::sendBinary(const void *data, size_t len) {
     websocketpp::lib::error_code ec;
-    m_client.send(m_hdl, message, websocketpp::frame::opcode::text, ec);
+    m_client.send(m_hdl, data, len, websocketpp::frame::opcode::binary, ec);
     if (ec) {
         LogMsg("Send Error: %s", ec.message().c_str());
     }
@@ -99,24 +144,38 @@ void WebSocketClient::send(const std::string &message) {
 
 // Event handler called when a connection is established.
 void WebSocketClient::on_open(websocketpp::connection_hdl hdl) {
-    LogMsg("Connection opened.");
+    websocketpp::lib::error_code ec;
+    auto con = m_client.get_con_from_hdl(hdl, ec);
+    const std::string subprotocol = ec ? "" : con->get_subprotocol();
+    m_format = subprotocol == SUBPROTO_DELTA    ? FORMAT_DELTA
+               : subprotocol == SUBPROTO_BINARY ? FORMAT_BINARY
+                                                : FORMAT_CSV;
+    m_open = true;
+    AppState::GetInstance()->OnWebSocketOpen();
+    LogMsg("Connection opened, using %s frames.",
+           subprotocol.empty() ? "text" : subprotocol.c_str());
 }
 
 // Event handler called when a message is received.
 void WebSocketClient::on_message(websocketpp::connection_hdl hdl,
                                  ws_client::message_ptr msg) {
-    AppState::GetInstance()->OnWebSocketMessage(msg->get_payload());
+    AppState::GetInstance()->OnWebSocketMessage(
+        msg->get_payload(),
+        msg->get_opcode() == websocketpp::frame::opcode::binary);
     return;
 }
 
 // Event handler called when the connection is closed.
 void WebSocketClient::on_close(websocketpp::connection_hdl hdl) {
+    m_format = FORMAT_CSV;
+    m_open = false;
     LogMsg("Attempting to reconnect...");
     this->reconnect();
 }
 
 // Event handler called when the connection fails.
 void WebSocketClient::on_fail(websocketpp::connection_hdl hdl) {
+    m_open = false;
     LogMsg("Attempting to reconnect...");
     this->reconnect();
 }
@@ -3,6 +3,7 @@
 
 #define ASIO_STANDALONE
 
+#include <atomic>
 #include <string>
 #include <thread>
 #include <websocketpp/client.hpp>
@@ -10,10 +11,17 @@
 #include <memory>
 #include <functional>
 
+#include "protocol.h"
 #include "util.h"
 
+#if INCLUDE_WS_DEFLATE
+#include "wsDeflate.h"
+// Type alias for the WebSocket++ client with permessage-deflate support.
+typedef websocketpp::client<deflate_asio_client> ws_client;
+#else
 // Type alias for the WebSocket++ client using the asio_client config.
 typedef websocketpp::client<websocketpp::config::asio_client> ws_client;
+#endif
 
 
 class WebSocketClient {
@@ -27,7 +35,11 @@ class WebSocketClient {
 
     // Public interface to connect and send messages.
     void connect(const std::string &uri);
-    void send(const std::string &message);
+    void send(std::string_view message);
+    void sendBinary(const void *data, size_t len);
+
+    // Frame format the server selected for the current connection
+    FrameFormat getFormat() const { return m_format; }
 
     // Destructor
     ~WebSocketClient();
@@ -43,12 +55,18 @@ class WebSocketClient {
     void on_close(websocketpp::connection_hdl hdl);
     void on_fail(websocketpp::connection_hdl hdl);
     void reconnect();
+    void scheduleSendTick();
+    void offerSubprotocols(ws_client::connection_ptr con);
 
     // Member variables.
     ws_client m_client;
     websocketpp::connection_hdl m_hdl;
     std::thread m_thread;
     std::string m_uri;
+    // Paces the send path on the asio thread
+    std::unique_ptr<asio::steady_timer> m_sendTimer;
+    bool m_open = false; // asio thread only
+    std::atomic<FrameFormat> m_format{FORMAT_CSV};
 };
 
 #endif // WEBSOCKETCLIENT_H
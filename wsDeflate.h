@@ -0,0 +1,58 @@
+//
+//  wsDeflate.h
+//  XPMP2-Sample
+//
+//  Created by Di Zou on 2026-10-16.
+//
+#ifndef WS_DEFLATE_H
+#define WS_DEFLATE_H
+
+// Only with a build that defines INCLUDE_WS_DEFLATE, which links zlib
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+
+#include "config.h"
+
+/// permessage-deflate, tuned by Config: only offered if `ws_deflate=1`,
+/// our compressor's window and context takeover as configured
+template <typename config>
+class TunedDeflate
+    : public websocketpp::extensions::permessage_deflate::enabled<config> {
+  public:
+    typedef websocketpp::extensions::permessage_deflate::enabled<config> base;
+
+    TunedDeflate() {
+        const Config *cfg = Config::GetInstance();
+        // Server may ask for a smaller window, never for a larger one
+        this->set_client_max_window_bits(
+            uint8_t(cfg->wsDeflateWindowBits),
+            websocketpp::extensions::permessage_deflate::mode::largest);
+        if (cfg->wsDeflateNoContextTakeover) {
+            this->enable_client_no_context_takeover();
+        }
+    }
+
+    /// Hides the base's fixed offer, called by the hybi13 processor
+    std::string generate_offer() const {
+        const Config *cfg = Config::GetInstance();
+        if (!cfg->wsDeflate) {
+            return ""; // don't offer at all
+        }
+        std::string offer = "permessage-deflate; client_max_window_bits";
+        if (cfg->wsDeflateNoContextTakeover) {
+            offer += "; client_no_context_takeover";
+        }
+        return offer;
+    }
+};
+
+/// asio_client config with permessage-deflate support
+struct deflate_asio_client : public websocketpp::config::asio_client {
+    typedef deflate_asio_client type;
+    typedef asio_client base;
+
+    struct permessage_deflate_config {};
+    typedef TunedDeflate<permessage_deflate_config> permessage_deflate_type;
+};
+
+#endif // WS_DEFLATE_H